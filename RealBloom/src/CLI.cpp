@@ -1,4 +1,4 @@
-#include "CLI.h"
+﻿#include "CLI.h"
 
 #define NOMINMAX
 #include <Windows.h>
@@ -13,11 +13,14 @@ namespace OCIO = OpenColorIO_v2_1;
 #include "ColorManagement/CmImageIO.h"
 
 #include "RealBloom/Diffraction.h"
+#include "RealBloom/DiffractionBatch.h"
 #include "RealBloom/Dispersion.h"
 #include "RealBloom/Convolution.h"
+#include "RealBloom/KernelBuilder.h"
 
 #include "Utils/ConsoleColors.h"
 #include "Utils/CliStackTimer.h"
+#include "Utils/LazyInit.h"
 #include "Utils/ImageTransform.h"
 #include "Utils/Misc.h"
 
@@ -38,6 +41,29 @@ namespace CLI
     static std::vector<Command> commands;
     static bool interrupt = false;
 
+    // Convolution module and its images
+    struct ConvSession
+    {
+        CmImage imgInput;
+        CmImage imgKernel;
+        CmImage imgConvPreview;
+        CmImage imgConvResult;
+        RealBloom::Convolution conv;
+
+        ConvSession()
+        {
+            conv.setImgInput(&imgInput);
+            conv.setImgKernel(&imgKernel);
+            conv.setImgConvPreview(&imgConvPreview);
+            conv.setImgConvResult(&imgConvResult);
+        }
+    };
+
+    // Kept between the commands of a session, so that the stage and
+    // transform caches carry over. Released before the OpenGL context.
+    static std::shared_ptr<RealBloom::KernelBuilder> kernelBuilder = nullptr;
+    static std::shared_ptr<ConvSession> convSession = nullptr;
+
     // Command actions
 
     void cmdVersion(const Command& cmd, const CliParser& parser, StringMap& args, bool verbose);
@@ -46,7 +72,9 @@ namespace CLI
     void cmdImageTransform(const Command& cmd, const CliParser& parser, StringMap& args, bool verbose);
 
     void cmdDiff(const Command& cmd, const CliParser& parser, StringMap& args, bool verbose);
+    void cmdDiffBatch(const Command& cmd, const CliParser& parser, StringMap& args, bool verbose);
     void cmdDisp(const Command& cmd, const CliParser& parser, StringMap& args, bool verbose);
+    void cmdKernel(const Command& cmd, const CliParser& parser, StringMap& args, bool verbose);
     void cmdConv(const Command& cmd, const CliParser& parser, StringMap& args, bool verbose);
 
     void cmdCmfDetails(const Command& cmd, const CliParser& parser, StringMap& args, bool verbose);
@@ -57,6 +85,9 @@ namespace CLI
     void cmdViews(const Command& cmd, const CliParser& parser, StringMap& args, bool verbose);
     void cmdLooks(const Command& cmd, const CliParser& parser, StringMap& args, bool verbose);
 
+    void cmdStartup(const Command& cmd, const CliParser& parser, StringMap& args, bool verbose);
+    void cmdImageCache(const Command& cmd, const CliParser& parser, StringMap& args, bool verbose);
+
     // Print the arguments of a command
     void printArguments(const Command& command)
     {
@@ -210,7 +241,10 @@ namespace CLI
             {{"--display", "-h"}, "Display name for view transform", "", ArgumentType::Optional},
             {{"--view", "-j"}, "View name for view transform", "", ArgumentType::Optional},
             {{"--look", "-l"}, "Look name for view transform", "", ArgumentType::Optional},
-            {{"--view-exposure"}, "Exposure for view transform", "0", ArgumentType::Optional}
+            {{"--view-exposure"}, "Exposure for view transform", "0", ArgumentType::Optional},
+            {{"--rgb-only"}, "Leave out the alpha channel", "", ArgumentType::Optional},
+            {{"--half"}, "Use 16-bit floats for OpenEXR", "", ArgumentType::Optional},
+            {{"--compression"}, "OpenEXR compression (none, zip, piz, dwaa)", "zip", ArgumentType::Optional}
             });
     }
 
@@ -574,6 +608,59 @@ namespace CLI
 
             addImageTransformArguments(cmd, "input", "Input");
 
+            insertContents(cmd.arguments, {
+                {{"--double", "-d"}, "Use double precision for the FFT", "", ArgumentType::Optional},
+                {{"--odd-size"}, "Use the nearest odd FFT size instead of the nearest 2-3-5-smooth size", "", ArgumentType::Optional},
+                {{"--no-resample"}, "Keep the FFT size instead of resampling back to the input size", "", ArgumentType::Optional},
+
+                {{"--spectral", "-s"}, "Compute a pattern for every wavelength (spectral diffraction)", "", ArgumentType::Optional},
+                {{"--amount", "-m"}, "Amount of dispersion (spectral)", "0.4", ArgumentType::Optional},
+                {{"--edge", "-e"}, "Edge offset (spectral)", "0", ArgumentType::Optional},
+                {{"--steps", "-n"}, "Number of wavelengths to sample (spectral)", "32", ArgumentType::Optional},
+                {{"--cmf", "-f"}, "CMF table filename (spectral)", "", ArgumentType::Optional}
+                });
+
+            addXyzConversionArguments(cmd);
+
+            commands.push_back(cmd);
+        }
+
+        // diff-batch
+        {
+            Command cmd
+            {
+                "diff-batch",
+                "Generate diffraction patterns for multiple apertures",
+                "diff-batch -i \"apertures/*.png\" -a sRGB -o patterns -e .exr -p w",
+                {},
+                {
+                    "The input can be a list of filenames separated by semicolons, or a pattern "
+                    "with * and ? in the filename. All apertures must have the same dimensions.",
+                    "Each output has the same name as its aperture, with the given extension."
+                },
+                cmdDiffBatch,
+                true
+            };
+
+            insertContents(cmd.arguments, {
+                {{"--input", "-i"}, "Input filenames or pattern", "", ArgumentType::Required},
+                {{"--input-space", "-a"}, "Input color space", "", ArgumentType::Required},
+                {{"--output", "-o"}, "Output directory", "", ArgumentType::Required},
+                {{"--extension", "-e"}, "Output file extension", ".exr", ArgumentType::Optional}
+                });
+
+            addOutputColorManagementArguments(cmd);
+
+            addImageTransformArguments(cmd, "input", "Input");
+
+            insertContents(cmd.arguments, {
+                {{"--double", "-d"}, "Use double precision for the FFT", "", ArgumentType::Optional},
+                {{"--odd-size"}, "Use the nearest odd FFT size instead of the nearest 2-3-5-smooth size", "", ArgumentType::Optional},
+                {{"--no-resample"}, "Keep the FFT size instead of resampling back to the input size", "", ArgumentType::Optional},
+                {{"--threads", "-t"}, "Number of threads to use", "", ArgumentType::Optional},
+                {{"--memory", "-m"}, "Memory budget in megabytes", "2048", ArgumentType::Optional}
+                });
+
             commands.push_back(cmd);
         }
 
@@ -617,6 +704,54 @@ namespace CLI
             commands.push_back(cmd);
         }
 
+        // kernel
+        {
+            Command cmd
+            {
+                "kernel",
+                "Generate a convolution kernel from an aperture (diffraction and dispersion)",
+                "kernel -i aperture.png -a sRGB -o kernel.exr -p w -m 0.4 -s 64",
+                {},
+                {
+                    "The diffraction pattern is passed to dispersion in memory.",
+                    "The stages are cached for the session, so changing the dispersion "
+                    "parameters doesn't compute diffraction again.",
+                    "conv uses the last kernel built when --kernel is left out."
+                },
+                cmdKernel,
+                true
+            };
+
+            insertContents(cmd.arguments, {
+                {{"--input", "-i"}, "Aperture filename", "", ArgumentType::Required},
+                {{"--input-space", "-a"}, "Aperture color space", "", ArgumentType::Required},
+                {{"--output", "-o"}, "Output filename", "", ArgumentType::Required}
+                });
+
+            addOutputColorManagementArguments(cmd);
+
+            addImageTransformArguments(cmd, "input", "Aperture");
+
+            insertContents(cmd.arguments, {
+                {{"--double"}, "Use double precision for the FFT", "", ArgumentType::Optional},
+                {{"--odd-size"}, "Use the nearest odd FFT size instead of the nearest 2-3-5-smooth size", "", ArgumentType::Optional},
+                {{"--no-resample"}, "Keep the FFT size instead of resampling back to the input size", "", ArgumentType::Optional},
+
+                {{"--no-disp"}, "Skip dispersion", "", ArgumentType::Optional},
+                {{"--amount", "-m"}, "Amount of dispersion", "0.4", ArgumentType::Optional},
+                {{"--edge", "-e"}, "Edge offset", "0", ArgumentType::Optional},
+                {{"--steps", "-s"}, "Number of wavelengths to sample", "32", ArgumentType::Optional},
+                {{"--gpu", "-g"}, "Use the GPU method for dispersion", "", ArgumentType::Optional},
+                {{"--threads", "-t"}, "Number of threads to use for dispersion", "", ArgumentType::Optional},
+
+                {{"--cmf", "-f"}, "CMF table filename", "", ArgumentType::Optional},
+                });
+
+            addXyzConversionArguments(cmd);
+
+            commands.push_back(cmd);
+        }
+
         // conv
         {
             Command cmd
@@ -633,8 +768,8 @@ namespace CLI
             insertContents(cmd.arguments, {
                 {{"--input", "-i"}, "Input filename", "", ArgumentType::Required},
                 {{"--input-space", "-a"}, "Input color space", "", ArgumentType::Required},
-                {{"--kernel", "-k"}, "Kernel filename", "", ArgumentType::Required},
-                {{"--kernel-space", "-b"}, "Kernel color space", "", ArgumentType::Required},
+                {{"--kernel", "-k"}, "Kernel filename, the last kernel built if not given", "", ArgumentType::Conditional},
+                {{"--kernel-space", "-b"}, "Kernel color space, required with --kernel", "", ArgumentType::Conditional},
                 {{"--output", "-o"}, "Output filename", "", ArgumentType::Required}
                 });
 
@@ -757,11 +892,49 @@ namespace CLI
             };
             commands.push_back(cmd);
         }
+
+        // startup
+        {
+            Command cmd
+            {
+                "startup",
+                "Print how long each startup phase took",
+                "",
+                {},
+                {
+                    "Color management is set up when a command first needs it, "
+                    "so its phases only show up after such a command has run."
+                },
+                cmdStartup
+            };
+            commands.push_back(cmd);
+        }
+
+        // image-cache
+        {
+            Command cmd
+            {
+                "image-cache",
+                "Print or change the usage of the decoded image cache",
+                "image-cache -b 2048",
+                {
+                    {{"--budget", "-b"}, "Memory budget in MB, 0 turns the cache off", "1024", ArgumentType::Optional},
+                    {{"--clear", "-c"}, "Drop the cached images", "", ArgumentType::Optional}
+                },
+                {
+                    "Images read by the commands are kept, so that reading the same file again "
+                    "with the same color space and transform doesn't decode it again."
+                },
+                cmdImageCache
+            };
+            commands.push_back(cmd);
+        }
     }
 
     void Interface::cleanUp()
     {
-        //
+        convSession = nullptr;
+        kernelBuilder = nullptr;
     }
 
     bool Interface::active()
@@ -774,6 +947,9 @@ namespace CLI
         // Enable console colors
         activateVirtualTerminal();
 
+        // Commands in a session often read the same files
+        CmImageIO::setCacheBudget(CMIMAGEIO_DEF_CACHE_BUDGET);
+
         // Handle Ctrl-C
         // https://learn.microsoft.com/en-us/windows/console/registering-a-control-handler-function
         if (!SetConsoleCtrlHandler(CtrlHandler, TRUE))
@@ -856,6 +1032,7 @@ namespace CLI
             std::cout << '\n';
         }
 
+        cleanUp();
         CMS::cleanUp();
     }
 
@@ -895,7 +1072,7 @@ namespace CLI
         {
             CliStackTimer timer("Read the input image");
             setInputColorSpace(inpColorSpace);
-            CmImageIO::readImage(img, inpFilename);
+            CmImageIO::readImage(img, inpFilename, &inputTransformParams);
             timer.done(verbose);
         }
 
@@ -908,7 +1085,7 @@ namespace CLI
 
             ImageTransform::apply(
                 inputTransformParams,
-                img.getImageDataVector(),
+                img.getConstImageDataVector(),
                 img.getWidth(),
                 img.getHeight(),
                 outputBuffer,
@@ -917,8 +1094,7 @@ namespace CLI
                 false);
 
             std::scoped_lock lock(img);
-            img.resize(outputWidth, outputHeight, false);
-            img.getImageDataVector() = std::move(outputBuffer);
+            img.setImageData(std::make_shared<FloatBuffer>(std::move(outputBuffer)), outputWidth, outputHeight);
 
             timer.done(verbose);
         }
@@ -958,11 +1134,34 @@ namespace CLI
         // Read image transform arguments
         readImageTransformArguments(args, "input", diff.getParams()->inputTransformParams);
 
+        diff.getParams()->doublePrecision = args.contains("--double");
+        diff.getParams()->fastSize = !args.contains("--odd-size");
+        diff.getParams()->resample = !args.contains("--no-resample");
+
+        // Spectral diffraction
+        diff.getParams()->spectral = args.contains("--spectral");
+        if (args.contains("--amount"))
+            diff.getParams()->spectralAmount = strToFloat(args["--amount"]);
+        if (args.contains("--edge"))
+            diff.getParams()->spectralEdgeOffset = strToFloat(args["--edge"]);
+        if (args.contains("--steps"))
+            diff.getParams()->spectralSteps = strToInt(args["--steps"]);
+
+        // CMF table
+        if (args.contains("--cmf"))
+        {
+            CmfTableInfo info("", args["--cmf"]);
+            CMF::setActiveTable(info);
+        }
+
+        // XYZ conversions
+        readXyzConversionArguments(args);
+
         // Read the input image
         {
             CliStackTimer timer("Read the input image");
             setInputColorSpace(inpColorSpace);
-            CmImageIO::readImage(*diff.getImgInputSrc(), inpFilename);
+            CmImageIO::readImage(*diff.getImgInputSrc(), inpFilename, &diff.getParams()->inputTransformParams);
             timer.done(verbose);
         }
 
@@ -977,6 +1176,24 @@ namespace CLI
         if (!diff.getStatus().isOK())
             throw std::exception(diff.getStatus().getError().c_str());
 
+        // Print the stages
+        if (verbose)
+        {
+            const RealBloom::DiffractionStats& stats = diff.getStats();
+            for (const auto& timing : stats.timings)
+                std::cout
+                << consoleColor(COL_SEC)
+                << strRightPadding(strFormat("%.1f ms", timing.second), 11)
+                << consoleColor()
+                << "  " << timing.first << "\n";
+
+            std::cout
+                << consoleColor(COL_SEC)
+                << strRightPadding("", 11)
+                << consoleColor()
+                << strFormat("  FFT size: %u x %u", stats.fftWidth, stats.fftHeight) << "\n";
+        }
+
         // Write the output image
         {
             CliStackTimer timer("Write the output image");
@@ -988,6 +1205,117 @@ namespace CLI
         totalTimer.done(verbose);
     }
 
+    void cmdDiffBatch(const Command& cmd, const CliParser& parser, StringMap& args, bool verbose)
+    {
+        CliStackTimer totalTimer("", true);
+
+        // Arguments
+
+        std::string inpColorSpace = CMS::resolveColorSpace(args["--input-space"]);
+
+        std::string outDir = args["--output"];
+        std::string outExtension = args.contains("--extension") ? args["--extension"] : ".exr";
+        if (!outExtension.starts_with("."))
+            outExtension = "." + outExtension;
+
+        OutputColorManagement outputCM(args, "output" + outExtension);
+
+        // Input filenames
+        std::vector<std::string> inpPatterns;
+        strSplit(args["--input"], ';', inpPatterns);
+
+        std::vector<std::string> inpFilenames;
+        for (const auto& item : inpPatterns)
+        {
+            std::string pattern = strTrim(item);
+            if (pattern.empty())
+                continue;
+
+            std::vector<std::string> found = findFiles(pattern);
+            if (found.empty())
+                throw std::exception(strFormat("No files were found for \"%s\".", pattern.c_str()).c_str());
+
+            insertContents(inpFilenames, found);
+        }
+
+        // Output filenames
+        std::vector<std::string> outFilenames;
+        for (const auto& inpFilename : inpFilenames)
+        {
+            std::filesystem::path outPath = std::filesystem::path(outDir) / std::filesystem::path(inpFilename).stem();
+            outFilenames.push_back(outPath.string() + outExtension);
+        }
+
+        if (!std::filesystem::is_directory(outDir))
+            std::filesystem::create_directories(outDir);
+
+        // Batch
+        RealBloom::DiffractionBatch batch;
+        RealBloom::DiffractionBatchParams* batchParams = batch.getParams();
+
+        readImageTransformArguments(args, "input", batchParams->diffParams.inputTransformParams);
+
+        batchParams->diffParams.doublePrecision = args.contains("--double");
+        batchParams->diffParams.fastSize = !args.contains("--odd-size");
+        batchParams->diffParams.resample = !args.contains("--no-resample");
+
+        if (args.contains("--threads"))
+            batchParams->numThreads = strToInt(args["--threads"]);
+
+        if (args.contains("--memory"))
+            batchParams->memoryBudget = (uint64_t)std::max(strToInt(args["--memory"]), (int64_t)1) * 1024ull * 1024ull;
+
+        // Read the input color space once, the readers run in parallel
+        setInputColorSpace(inpColorSpace);
+        outputCM.apply();
+
+        // Compute
+        {
+            CliStackTimer timer(strFormat("Compute (%u apertures)", (uint32_t)inpFilenames.size()));
+            batch.compute(
+                inpFilenames.size(),
+                [&inpFilenames](uint32_t index, CmImage& target)
+                {
+                    CmImageIO::readImage(target, inpFilenames[index], nullptr, false);
+                },
+                [&outFilenames, verbose](uint32_t index, CmImage& result)
+                {
+                    CmImageIO::writeImage(result, outFilenames[index]);
+                    if (verbose)
+                        std::cout << consoleColor(COL_SEC) << strRightPadding("", 11) << consoleColor() << "  " << outFilenames[index] << "\n";
+                });
+            timer.done(verbose);
+        }
+
+        const RealBloom::DiffractionBatchStats& stats = batch.getStats();
+
+        if (verbose)
+        {
+            std::cout
+                << consoleColor(COL_SEC)
+                << strRightPadding("", 11)
+                << consoleColor()
+                << strFormat(
+                    "  %u workers, %u threads each, %s per worker",
+                    stats.numWorkers,
+                    stats.threadsPerWorker,
+                    strFromDataSize(stats.memoryPerWorker).c_str())
+                << "\n";
+        }
+
+        // Print the failed items
+        for (size_t i = 0; i < stats.items.size(); i++)
+        {
+            if (!stats.items[i].ok)
+                printError(__FUNCTION__, inpFilenames[i], stats.items[i].error);
+        }
+
+        if (!batch.getStatus().isOK())
+            throw std::exception(batch.getStatus().getError().c_str());
+
+        totalTimer.done(verbose);
+    }
+
     void cmdDisp(const Command& cmd, const CliParser& parser, StringMap& args, bool verbose)
     {
         CliStackTimer totalTimer("", true);
@@ -1048,7 +1376,7 @@ namespace CLI
         {
             CliStackTimer timer("Read the input image");
             setInputColorSpace(inpColorSpace);
-            CmImageIO::readImage(*disp.getImgInputSrc(), inpFilename);
+            CmImageIO::readImage(*disp.getImgInputSrc(), inpFilename, &disp.getParams()->inputTransformParams);
             timer.done(verbose);
         }
 
@@ -1099,6 +1427,102 @@ namespace CLI
         totalTimer.done(verbose);
     }
 
+    void cmdKernel(const Command& cmd, const CliParser& parser, StringMap& args, bool verbose)
+    {
+        CliStackTimer totalTimer("", true);
+
+        // Arguments
+
+        std::string inpFilename = args["--input"];
+        std::string inpColorSpace = CMS::resolveColorSpace(args["--input-space"]);
+
+        std::string outFilename = args["--output"];
+        OutputColorManagement outputCM(args, outFilename);
+
+        // CMF table
+        if (args.contains("--cmf"))
+        {
+            CmfTableInfo info("", args["--cmf"]);
+            CMF::setActiveTable(info);
+        }
+
+        // XYZ conversions
+        readXyzConversionArguments(args);
+
+        // Kernel builder
+        if (!kernelBuilder)
+            kernelBuilder = std::make_shared<RealBloom::KernelBuilder>();
+        RealBloom::KernelBuilder& builder = *kernelBuilder;
+
+        CmImage imgOutput;
+        builder.setImgKernel(&imgOutput);
+
+        RealBloom::KernelBuilderParams* params = builder.getParams();
+        *params = RealBloom::KernelBuilderParams();
+
+        readImageTransformArguments(args, "input", params->diffParams.inputTransformParams);
+        params->diffParams.doublePrecision = args.contains("--double");
+        params->diffParams.fastSize = !args.contains("--odd-size");
+        params->diffParams.resample = !args.contains("--no-resample");
+
+        params->useDispersion = !args.contains("--no-disp");
+        if (args.contains("--amount"))
+            params->dispParams.amount = strToFloat(args["--amount"]);
+        if (args.contains("--edge"))
+            params->dispParams.edgeOffset = strToFloat(args["--edge"]);
+        if (args.contains("--steps"))
+            params->dispParams.steps = strToInt(args["--steps"]);
+
+        params->dispParams.methodInfo.method =
+            args.contains("--gpu") ? RealBloom::DispersionMethod::GPU : RealBloom::DispersionMethod::CPU;
+        if (args.contains("--threads"))
+            params->dispParams.methodInfo.numThreads = strToInt(args["--threads"]);
+
+        // Read the aperture
+        {
+            CliStackTimer timer("Read the aperture");
+            setInputColorSpace(inpColorSpace);
+            CmImageIO::readImage(*builder.getImgApertureSrc(), inpFilename, &params->diffParams.inputTransformParams);
+            timer.done(verbose);
+        }
+
+        // Build
+        {
+            CliStackTimer timer("Build");
+            builder.build([]() { return interrupt; });
+            builder.setImgKernel(nullptr);
+            timer.done(verbose);
+        }
+
+        if (interrupt)
+            return;
+
+        // Print error
+        if (!builder.getStatus().isOK())
+            throw std::exception(builder.getStatus().getError().c_str());
+
+        // Print the stages
+        if (verbose)
+        {
+            for (const auto& timing : builder.getStats().timings)
+                std::cout
+                << consoleColor(COL_SEC)
+                << strRightPadding(strFormat("%.1f ms", timing.second), 11)
+                << consoleColor()
+                << "  " << timing.first << "\n";
+        }
+
+        // Write the output image
+        {
+            CliStackTimer timer("Write the output image");
+            outputCM.apply();
+            CmImageIO::writeImage(imgOutput, outFilename);
+            timer.done(verbose);
+        }
+
+        totalTimer.done(verbose);
+    }
+
     void cmdConv(const Command& cmd, const CliParser& parser, StringMap& args, bool verbose)
     {
         CliStackTimer totalTimer("", true);
@@ -1108,8 +1532,22 @@ namespace CLI
         std::string inpFilename = args["--input"];
         std::string inpColorSpace = CMS::resolveColorSpace(args["--input-space"]);
 
-        std::string knlFilename = args["--kernel"];
-        std::string knlColorSpace = CMS::resolveColorSpace(args["--kernel-space"]);
+        // The last kernel built is used if no file is given
+        bool builtKernel = !args.contains("--kernel");
+        std::string knlFilename = "";
+        std::string knlColorSpace = "";
+        if (builtKernel)
+        {
+            if (!kernelBuilder || (kernelBuilder->getKernelKey() == 0))
+                throw std::exception("No kernel has been built yet, use kernel or --kernel.");
+        }
+        else
+        {
+            if (!args.contains("--kernel-space"))
+                throw std::exception("--kernel-space is required with --kernel.");
+            knlFilename = args["--kernel"];
+            knlColorSpace = CMS::resolveColorSpace(args["--kernel-space"]);
+        }
 
         std::string outFilename = args["--output"];
         OutputColorManagement outputCM(args, outFilename);
@@ -1175,20 +1613,14 @@ namespace CLI
         if (args.contains("--blend-exposure"))
             blendExposure = strToFloat(args["--blend-exposure"]);
 
-        // Images
-
-        CmImage imgInput;
-        CmImage imgKernel;
-        CmImage imgConvPreview;
-        CmImage imgConvResult;
-
-        // Convolution
+        // Convolution, kept for the session so that an unchanged kernel
+        // isn't transformed again
 
-        RealBloom::Convolution conv;
-        conv.setImgInput(&imgInput);
-        conv.setImgKernel(&imgKernel);
-        conv.setImgConvPreview(&imgConvPreview);
-        conv.setImgConvResult(&imgConvResult);
+        if (!convSession)
+            convSession = std::make_shared<ConvSession>();
+        RealBloom::Convolution& conv = convSession->conv;
+        CmImage& imgConvResult = convSession->imgConvResult;
+        *conv.getParams() = RealBloom::ConvolutionParams();
 
         // Read image transform arguments
         readImageTransformArguments(args, "input", conv.getParams()->inputTransformParams);
@@ -1198,15 +1630,23 @@ namespace CLI
         {
             CliStackTimer timer("Read the input image");
             setInputColorSpace(inpColorSpace);
-            CmImageIO::readImage(*conv.getImgInputSrc(), inpFilename);
+            CmImageIO::readImage(*conv.getImgInputSrc(), inpFilename, &conv.getParams()->inputTransformParams);
             timer.done(verbose);
         }
 
-        // Read the kernel image
+        // Read the kernel image, or share the built kernel if it isn't
+        // there already
+        if (builtKernel)
+        {
+            CliStackTimer timer("Apply the built kernel");
+            kernelBuilder->applyTo(conv);
+            timer.done(verbose);
+        }
+        else
         {
             CliStackTimer timer("Read the kernel image");
             setInputColorSpace(knlColorSpace);
-            CmImageIO::readImage(*conv.getImgKernelSrc(), knlFilename);
+            CmImageIO::readImage(*conv.getImgKernelSrc(), knlFilename, &conv.getParams()->kernelTransformParams);
             timer.done(verbose);
         }
 
@@ -1377,6 +1817,45 @@ namespace CLI
         }
     }
 
+    void cmdStartup(const Command& cmd, const CliParser& parser, StringMap& args, bool verbose)
+    {
+        float totalMs = 0.0f;
+        for (const auto& phase : StartupTimes::get())
+        {
+            std::cout
+                << consoleColor(COL_SEC)
+                << strRightPadding(strFormat("%.1f ms", phase.elapsedMs), 11)
+                << consoleColor()
+                << phase.name << "\n";
+            totalMs += phase.elapsedMs;
+        }
+
+        std::cout
+            << consoleColor(COL_PRI)
+            << "Total: "
+            << consoleColor(COL_SEC)
+            << strFormat("%.1f ms", totalMs)
+            << consoleColor() << "\n";
+    }
+
+    void cmdImageCache(const Command& cmd, const CliParser& parser, StringMap& args, bool verbose)
+    {
+        if (args.contains("--clear"))
+            CmImageIO::clearCache();
+
+        if (args.contains("--budget"))
+            CmImageIO::setCacheBudget((uint64_t)std::max(strToInt(args["--budget"]), (int64_t)0) * 1024ull * 1024ull);
+
+        std::cout
+            << consoleColor(COL_PRI) << "Images: " << consoleColor()
+            << CmImageIO::getCacheCount() << "\n"
+            << consoleColor(COL_PRI) << "Usage:  " << consoleColor()
+            << strFormat("%.1f / %.1f MB",
+                (double)CmImageIO::getCacheUsage() / (1024.0 * 1024.0),
+                (double)CmImageIO::getCacheBudget() / (1024.0 * 1024.0))
+            << "\n";
+    }
+
     OutputColorManagement::OutputColorManagement(StringMap& args, const std::string& filename)
     {
         std::string extension = getFileExtension(filename);
@@ -1387,6 +1866,11 @@ namespace CLI
         view = CMS::getActiveView();
         look = CMS::getActiveLook();
 
+        // Only apply to this command, apply() sets them globally
+        rgbOnly = false;
+        exrHalf = false;
+        exrCompression = ExrCompression::Zip;
+
         if (args.contains("--display"))
             display = args["--display"];
 
@@ -1399,6 +1883,27 @@ namespace CLI
         if (args.contains("--view-exposure"))
             exposure = strToFloat(args["--view-exposure"]);
 
+        if (args.contains("--rgb-only"))
+            rgbOnly = true;
+
+        if (args.contains("--half"))
+            exrHalf = true;
+
+        if (args.contains("--compression"))
+        {
+            std::string name = strLowercase(args["--compression"]);
+            const std::vector<std::string>& names = CmImageIO::getExrCompressionNames();
+
+            int index = -1;
+            for (size_t i = 0; i < names.size(); i++)
+                if (strLowercase(names[i]) == name)
+                    index = (int)i;
+
+            if (index < 0)
+                throw std::exception(strFormat("Compression \"%s\" isn't supported.", args["--compression"].c_str()).c_str());
+            exrCompression = (ExrCompression)index;
+        }
+
         /*
         *    Arguments:
         *
@@ -1420,6 +1925,8 @@ namespace CLI
         *            enable view transform
         *    else: is it non-linear?
         *        enable view transform
+        *    else: is it native?
+        *        write as is (working space)
         *    else
         *        throw error (unsupported format)
         */
@@ -1447,6 +1954,11 @@ namespace CLI
         {
             applyViewTransform = true;
         }
+        else if (contains(CmImageIO::getNativeExtensions(), extension))
+        {
+            // Always written in the working space
+            applyViewTransform = false;
+        }
         else
         {
             throw std::exception(strFormat("File extension \"%s\" isn't supported.", extension.c_str()).c_str());
@@ -1458,6 +1970,9 @@ namespace CLI
         // Set CmImageIO parameters
         CmImageIO::setOutputSpace(colorSpace);
         CmImageIO::setApplyViewTransform(applyViewTransform);
+        CmImageIO::setRgbOnly(rgbOnly);
+        CmImageIO::setExrHalf(exrHalf);
+        CmImageIO::setExrCompression(exrCompression);
 
         // Set view transform parameters
         CMS::setActiveDisplay(display);
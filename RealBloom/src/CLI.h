@@ -12,6 +12,9 @@
 
 #include "Utils/CliParser.h"
 
+// CmImageIO.h includes this header through CMS.h
+enum class ExrCompression;
+
 namespace CLI
 {
 
@@ -70,6 +73,9 @@ namespace CLI
         std::string view = "";
         std::string look = "";
         float exposure = 0.0f;
+        bool rgbOnly = false;
+        bool exrHalf = false;
+        ExrCompression exrCompression;
 
         OutputColorManagement(StringMap& args, const std::string& filename);
         void apply();
@@ -171,28 +171,13 @@ void CmfTable::sampleRGB(size_t numSamples, bool normalize, std::vector<float>&
         if (info.method == XyzConversionMethod::None)
             throw std::exception("An XYZ conversion method was not specified.");
 
-        OCIO::PackedImageDesc img(
-            outSamples.data(),
-            numSamples,
-            1,
-            OCIO::ChannelOrdering::CHANNEL_ORDERING_RGB,
-            OCIO::BitDepth::BIT_DEPTH_F32,
-            4,                    // 4 bytes to go to the next color channel
-            3 * 4,                // 3 color channels * 4 bytes per channel (till the next pixel)
-            numSamples * 3 * 4);  // width * 3 channels * 4 bytes (till the next row)
-
         if (info.method == XyzConversionMethod::UserConfig)
         {
             // Transform: XYZ -> Working Space (user config)
             stage = "Transform (UserConfig)";
             {
-                OCIO::ColorSpaceTransformRcPtr transform = OCIO::ColorSpaceTransform::Create();
-                transform->setSrc(info.userSpace.c_str());
-                transform->setDst(OCIO::ROLE_SCENE_LINEAR);
-
-                OCIO::ConstProcessorRcPtr proc = userConfig->getProcessor(transform);
-                OCIO::ConstCPUProcessorRcPtr cpuProc = proc->getDefaultCPUProcessor();
-                cpuProc->apply(img);
+                OCIO::ConstCPUProcessorRcPtr cpuProc = CMS::getCpuProcessor(userConfig, info.userSpace, OCIO::ROLE_SCENE_LINEAR);
+                CMS::applyCpuProcessor(cpuProc, outSamples.data(), (uint32_t)numSamples, 1, 3);
             }
         }
         else if (info.method == XyzConversionMethod::CommonSpace)
@@ -200,25 +185,15 @@ void CmfTable::sampleRGB(size_t numSamples, bool normalize, std::vector<float>&
             // Transform 1: XYZ -> Common Space (internal config)
             stage = "Transform 1 (CommonSpace)";
             {
-                OCIO::ColorSpaceTransformRcPtr transform = OCIO::ColorSpaceTransform::Create();
-                transform->setSrc(CMS::getInternalXyzSpace().c_str());
-                transform->setDst(info.commonInternal.c_str());
-
-                OCIO::ConstProcessorRcPtr proc = internalConfig->getProcessor(transform);
-                OCIO::ConstCPUProcessorRcPtr cpuProc = proc->getDefaultCPUProcessor();
-                cpuProc->apply(img);
+                OCIO::ConstCPUProcessorRcPtr cpuProc = CMS::getCpuProcessor(internalConfig, CMS::getInternalXyzSpace(), info.commonInternal);
+                CMS::applyCpuProcessor(cpuProc, outSamples.data(), (uint32_t)numSamples, 1, 3);
             }
 
             // Transform 2: Common Space -> Working Space (user config)
             stage = "Transform 2 (CommonSpace)";
             {
-                OCIO::ColorSpaceTransformRcPtr transform = OCIO::ColorSpaceTransform::Create();
-                transform->setSrc(info.commonUser.c_str());
-                transform->setDst(OCIO::ROLE_SCENE_LINEAR);
-
-                OCIO::ConstProcessorRcPtr proc = userConfig->getProcessor(transform);
-                OCIO::ConstCPUProcessorRcPtr cpuProc = proc->getDefaultCPUProcessor();
-                cpuProc->apply(img);
+                OCIO::ConstCPUProcessorRcPtr cpuProc = CMS::getCpuProcessor(userConfig, info.commonUser, OCIO::ROLE_SCENE_LINEAR);
+                CMS::applyCpuProcessor(cpuProc, outSamples.data(), (uint32_t)numSamples, 1, 3);
             }
         }
 
@@ -266,6 +241,7 @@ CmfTableInfo::CmfTableInfo(const std::string& name, const std::string& path)
 
 CMF::CmfVars CMF::S_VARS;
 BaseStatus CMF::S_STATUS;
+LazyInit CMF::S_INIT("Color Matching Functions");
 
 void CMF::retrieveTables()
 {
@@ -288,7 +264,18 @@ void CMF::retrieveTables()
     }
 }
 
+void CMF::ensureInit()
+{
+    S_INIT.ensure(initInternal);
+}
+
 bool CMF::init()
+{
+    ensureInit();
+    return S_STATUS.isOK();
+}
+
+void CMF::initInternal()
 {
     try
     {
@@ -315,8 +302,6 @@ bool CMF::init()
         if ((!CMF::hasTable()) && (S_VARS.tables.size() > 0))
             setActiveTable(S_VARS.tables[0]);
     }
-
-    return S_STATUS.isOK();
 }
 
 void CMF::cleanUp()
@@ -326,26 +311,31 @@ void CMF::cleanUp()
 
 const std::vector<CmfTableInfo>& CMF::getTables()
 {
+    ensureInit();
     return S_VARS.tables;
 }
 
 std::shared_ptr<CmfTable> CMF::getActiveTable()
 {
+    ensureInit();
     return S_VARS.activeTable;
 }
 
 const CmfTableInfo& CMF::getActiveTableInfo()
 {
+    ensureInit();
     return S_VARS.activeTableInfo;
 }
 
 const std::string& CMF::getActiveTableDetails()
 {
+    ensureInit();
     return S_VARS.activeTableDetails;
 }
 
 void CMF::setActiveTable(const CmfTableInfo& tableInfo)
 {
+    ensureInit();
     S_STATUS.reset();
 
     S_VARS.activeTable = nullptr;
@@ -378,11 +368,13 @@ void CMF::setActiveTable(const CmfTableInfo& tableInfo)
 
 bool CMF::hasTable()
 {
+    ensureInit();
     return (S_VARS.activeTable.get() != nullptr);
 }
 
 const BaseStatus& CMF::getStatus()
 {
+    ensureInit();
     return S_STATUS;
 }
 
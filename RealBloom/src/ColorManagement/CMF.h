@@ -13,6 +13,7 @@
 #include "CmXYZ.h"
 
 #include "../Utils/Status.h"
+#include "../Utils/LazyInit.h"
 #include "../Utils/Misc.h"
 #include "../Utils/NumberHelpers.h"
 
@@ -60,6 +61,7 @@ public:
     CMF(const CMF&) = delete;
     CMF& operator= (const CMF&) = delete;
 
+    // Called on first use, calling it beforehand moves the cost up front
     static bool init();
     static void cleanUp();
 
@@ -84,6 +86,10 @@ private:
     static CmfVars S_VARS;
     static BaseStatus S_STATUS;
 
+    static LazyInit S_INIT;
+    static void ensureInit();
+    static void initInternal();
+
     static void retrieveTables();
 
 };
@@ -1,4 +1,10 @@
 #include "CMS.h"
+#include "CmLut3D.h"
+
+#include <fstream>
+
+#include "../Utils/Hash.h"
+#include "../Utils/Random.h"
 
 std::string CMS::CONFIG_PATH = getLocalPath("ocio/config.ocio");
 std::string CMS::INTERNAL_CONFIG_PATH = getLocalPath("assets/internal/ocio/config.ocio");
@@ -7,6 +13,27 @@ bool CMS::USE_GPU = true;
 
 CMS::CmVars CMS::S_VARS;
 BaseStatus CMS::S_STATUS;
+LazyInit CMS::S_INIT("Color Management System");
+
+std::unordered_map<std::string, CMS::CachedProcessor> CMS::S_PROCESSORS;
+std::mutex CMS::S_PROCESSORS_MUTEX;
+
+// The cache is emptied when it gets larger than this
+static constexpr size_t PROCESSOR_CACHE_SIZE = 64;
+
+// Baked LUTs, the least recently used files are deleted first
+static const std::string LUT_CACHE_DIR = getLocalPath("cache/lut");
+static constexpr size_t LUT_CACHE_MAX_FILES = 32;
+
+static void hashFile(Hasher& hasher, const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    hasher.add(content);
+}
+
+// Bands smaller than this aren't worth a thread
+static constexpr uint32_t APPLY_MIN_BAND_PIXELS = 16 * 1024;
 
 void CMS::CmVars::retrieveColorSpaces()
 {
@@ -89,7 +116,18 @@ void CMS::ensureProcessors()
     updateProcessors();
 }
 
+void CMS::ensureInit()
+{
+    S_INIT.ensure(initInternal);
+}
+
 bool CMS::init()
+{
+    ensureInit();
+    return S_STATUS.isOK();
+}
+
+void CMS::initInternal()
 {
     std::string stage = "";
 
@@ -124,82 +162,96 @@ bool CMS::init()
     {
         S_STATUS.setError(makeError(__FUNCTION__, stage, e.what(), true));
     }
-
-    return S_STATUS.isOK();
 }
 
 void CMS::cleanUp()
 {
     S_VARS.shader = nullptr;
+    S_VARS.viewLut = nullptr;
+    clearProcessorCache();
 }
 
 OCIO::ConstConfigRcPtr CMS::getInternalConfig()
 {
+    ensureInit();
     return S_VARS.internalConfig;
 }
 
 OCIO::ConstConfigRcPtr CMS::getConfig()
 {
+    ensureInit();
     return S_VARS.config;
 }
 
 const std::string& CMS::getInternalXyzSpace()
 {
+    ensureInit();
     return S_VARS.internalXyzSpace;
 }
 
 const std::string& CMS::getWorkingSpace()
 {
+    ensureInit();
     return S_VARS.workingSpace;
 }
 
 const std::string& CMS::getWorkingSpaceDesc()
 {
+    ensureInit();
     return S_VARS.workingSpaceDesc;
 }
 
 const std::vector<std::string>& CMS::getInternalColorSpaces()
 {
+    ensureInit();
     return S_VARS.internalColorSpaces;
 }
 
 const std::vector<std::string>& CMS::getColorSpaces()
 {
+    ensureInit();
     return S_VARS.colorSpaces;
 }
 
 const std::vector<std::string>& CMS::getDisplays()
 {
+    ensureInit();
     return S_VARS.displays;
 }
 
 const std::vector<std::string>& CMS::getViews()
 {
+    ensureInit();
     return S_VARS.views;
 }
 
 const std::vector<std::string>& CMS::getLooks()
 {
+    ensureInit();
     return S_VARS.looks;
 }
 
 const std::string& CMS::getActiveDisplay()
 {
+    ensureInit();
     return S_VARS.activeDisplay;
 }
 
 const std::string& CMS::getActiveView()
 {
+    ensureInit();
     return S_VARS.activeView;
 }
 
 const std::string& CMS::getActiveLook()
 {
+    ensureInit();
     return S_VARS.activeLook;
 }
 
 void CMS::setActiveDisplay(const std::string& display)
 {
+    ensureInit();
     S_VARS.activeDisplay = display;
     S_VARS.retrieveViews();
     if (!contains(S_VARS.views, S_VARS.activeView))
@@ -210,11 +262,13 @@ void CMS::setActiveDisplay(const std::string& display)
 
 void CMS::setActiveView(const std::string& view)
 {
+    ensureInit();
     S_VARS.activeView = view;
 }
 
 void CMS::setActiveLook(const std::string& look)
 {
+    ensureInit();
     S_VARS.activeLook = look;
 }
 
@@ -230,6 +284,7 @@ void CMS::setExposure(float exposure)
 
 void CMS::updateProcessors()
 {
+    ensureInit();
     S_STATUS.reset();
 
     try
@@ -276,10 +331,28 @@ void CMS::updateProcessors()
         S_VARS.groupTransform->appendTransform(displayViewTransform);
 
         // Get processors
-        S_VARS.processor = S_VARS.config->getProcessor(S_VARS.groupTransform);
-        S_VARS.cpuProcessor = S_VARS.processor->getDefaultCPUProcessor();
+        CachedProcessor cached = getCachedProcessor(
+            config,
+            strFormat("DisplayView\n%s\n%s\n%s\nForward", (useLook ? lookName : "").c_str(), S_VARS.activeDisplay.c_str(), S_VARS.activeView.c_str()),
+            S_VARS.groupTransform);
+        S_VARS.processor = cached.processor;
+        S_VARS.cpuProcessor = cached.cpuProcessor;
         S_VARS.gpuProcessor = S_VARS.processor->getDefaultGPUProcessor();
 
+        // Bake the LUT, the exact processor is used if this fails
+        S_VARS.viewLut = nullptr;
+        if (S_VARS.viewLutSize > 0)
+        {
+            try
+            {
+                S_VARS.viewLut = loadOrBakeViewLut(useLook ? lookName : "");
+            }
+            catch (const std::exception& e)
+            {
+                printError(__FUNCTION__, "Bake LUT", e.what());
+            }
+        }
+
         if (USE_GPU)
         {
             // Prepare shader description
@@ -311,6 +384,214 @@ OCIO::ConstCPUProcessorRcPtr CMS::getCpuProcessor()
     return nullptr;
 }
 
+void CMS::applyCpuProcessor(
+    OCIO::ConstCPUProcessorRcPtr processor,
+    float* buffer,
+    uint32_t width,
+    uint32_t height,
+    uint32_t numChannels)
+{
+    const uint32_t numThreads = getMaxNumThreads();
+    const uint32_t minBandHeight = std::max(APPLY_MIN_BAND_PIXELS / std::max(width, 1u), 1u);
+    const uint32_t bandHeight = std::max((height + numThreads - 1) / numThreads, minBandHeight);
+    const int numBands = (int)((height + bandHeight - 1) / bandHeight);
+
+    const OCIO::ChannelOrdering ordering = (numChannels == 3)
+        ? OCIO::ChannelOrdering::CHANNEL_ORDERING_RGB
+        : OCIO::ChannelOrdering::CHANNEL_ORDERING_RGBA;
+
+    // The first error is thrown once all the bands are done
+    std::exception_ptr error = nullptr;
+
+#pragma omp parallel for if (numBands > 1)
+    for (int i = 0; i < numBands; i++)
+    {
+        const uint32_t bandY = (uint32_t)i * bandHeight;
+        const uint32_t numRows = std::min(bandHeight, height - bandY);
+
+        try
+        {
+            OCIO::PackedImageDesc img(
+                buffer + ((size_t)bandY * width * numChannels),
+                width,
+                numRows,
+                ordering,
+                OCIO::BitDepth::BIT_DEPTH_F32,
+                4,                           // 4 bytes to go to the next color channel
+                numChannels * 4,             // Channels * 4 bytes per channel (till the next pixel)
+                width * numChannels * 4);    // width * channels * 4 bytes (till the next row)
+
+            processor->apply(img);
+        }
+        catch (...)
+        {
+#pragma omp critical
+            {
+                if (!error)
+                    error = std::current_exception();
+            }
+        }
+    }
+
+    if (error)
+        std::rethrow_exception(error);
+}
+
+uint32_t CMS::getParallelApplyPixels()
+{
+    return getMaxNumThreads() * APPLY_MIN_BAND_PIXELS;
+}
+
+OCIO::ConstCPUProcessorRcPtr CMS::getCpuProcessor(
+    OCIO::ConstConfigRcPtr config,
+    const std::string& src,
+    const std::string& dst)
+{
+    OCIO::ColorSpaceTransformRcPtr transform = OCIO::ColorSpaceTransform::Create();
+    transform->setSrc(src.c_str());
+    transform->setDst(dst.c_str());
+
+    return getCachedProcessor(
+        config,
+        strFormat("ColorSpace\n%s\n%s\nForward", src.c_str(), dst.c_str()),
+        transform).cpuProcessor;
+}
+
+void CMS::clearProcessorCache()
+{
+    std::scoped_lock lock(S_PROCESSORS_MUTEX);
+    S_PROCESSORS.clear();
+}
+
+CMS::CachedProcessor CMS::getCachedProcessor(
+    OCIO::ConstConfigRcPtr config,
+    const std::string& key,
+    OCIO::ConstTransformRcPtr transform)
+{
+    // The cache ID changes with the content of the config and its context
+    std::string fullKey = strFormat("%p\n%s\n%s", (const void*)config.get(), config->getCacheID(), key.c_str());
+
+    std::scoped_lock lock(S_PROCESSORS_MUTEX);
+
+    auto it = S_PROCESSORS.find(fullKey);
+    if (it != S_PROCESSORS.end())
+        return it->second;
+
+    // Built while locked so that threads asking for the same processor
+    // don't build it more than once
+    CachedProcessor cached;
+    cached.processor = config->getProcessor(transform);
+    cached.cpuProcessor = cached.processor->getDefaultCPUProcessor();
+
+    if (S_PROCESSORS.size() >= PROCESSOR_CACHE_SIZE)
+        S_PROCESSORS.clear();
+    S_PROCESSORS[fullKey] = cached;
+
+    return cached;
+}
+
+std::shared_ptr<const CmLut3D> CMS::loadOrBakeViewLut(const std::string& look)
+{
+    // Only needed for the LUT cache, so the config files are hashed the
+    // first time a LUT is used
+    if (!S_VARS.hasConfigHash)
+    {
+        Hasher configHasher;
+        hashFile(configHasher, INTERNAL_CONFIG_PATH);
+        hashFile(configHasher, CONFIG_PATH);
+        S_VARS.configHash = configHasher.get();
+        S_VARS.hasConfigHash = true;
+    }
+
+    // The cache ID of the processor covers the content of the LUT files
+    // that the config refers to
+    Hasher hasher;
+    hasher.add(S_VARS.configHash);
+    hasher.add(std::string(S_VARS.processor->getCacheID()));
+    hasher.add(look).add(S_VARS.activeDisplay).add(S_VARS.activeView);
+    hasher.add(S_VARS.viewLutSize);
+    uint64_t key = hasher.get();
+
+    std::string filename = LUT_CACHE_DIR + getPathSeparator() + strFormat("%016llx.lut", key);
+
+    // Load
+    {
+        std::ifstream file(filename, std::ios::binary);
+        if (file.is_open())
+        {
+            std::shared_ptr<CmLut3D> lut = CmLut3D::read(file, key);
+            if (lut && (lut->getSize() == S_VARS.viewLutSize))
+            {
+                std::error_code ec;
+                std::filesystem::last_write_time(filename, std::filesystem::file_time_type::clock::now(), ec);
+                return lut;
+            }
+        }
+    }
+
+    // Bake and store
+    std::shared_ptr<CmLut3D> lut = std::make_shared<CmLut3D>(S_VARS.cpuProcessor, S_VARS.viewLutSize);
+
+    // Written under a temporary name first, so that other processes never
+    // read a partial file
+    std::string tempFilename = filename + strFormat(".%016llx.tmp", Random::nextU64());
+    try
+    {
+        std::filesystem::create_directories(LUT_CACHE_DIR);
+        {
+            std::ofstream file(tempFilename, std::ios::binary | std::ios::trunc);
+            stmCheck(file, __FUNCTION__, "Open");
+            lut->write(file, key);
+        }
+        std::filesystem::rename(tempFilename, filename);
+
+        pruneLutCache();
+    }
+    catch (const std::exception& e)
+    {
+        std::error_code ec;
+        std::filesystem::remove(tempFilename, ec);
+        printError(__FUNCTION__, "Write cache", e.what());
+    }
+
+    return lut;
+}
+
+void CMS::pruneLutCache()
+{
+    std::error_code ec;
+    std::vector<std::pair<std::filesystem::file_time_type, std::filesystem::path>> files;
+    for (const auto& entry : std::filesystem::directory_iterator(LUT_CACHE_DIR, ec))
+    {
+        if (entry.is_regular_file(ec) && (entry.path().extension() == ".lut"))
+            files.push_back({ entry.last_write_time(ec), entry.path() });
+    }
+
+    if (files.size() <= LUT_CACHE_MAX_FILES)
+        return;
+
+    // Newest first
+    std::sort(files.begin(), files.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+    for (size_t i = LUT_CACHE_MAX_FILES; i < files.size(); i++)
+        std::filesystem::remove(files[i].second, ec);
+}
+
+uint32_t CMS::getViewLutSize()
+{
+    return S_VARS.viewLutSize;
+}
+
+void CMS::setViewLutSize(uint32_t size)
+{
+    S_VARS.viewLutSize = (size > 0) ? std::clamp(size, CMLUT3D_MIN_SIZE, CMLUT3D_MAX_SIZE) : 0;
+}
+
+std::shared_ptr<const CmLut3D> CMS::getViewLut()
+{
+    ensureProcessors();
+    return S_VARS.viewLut;
+}
+
 OCIO::ConstGPUProcessorRcPtr CMS::getGpuProcessor()
 {
     ensureProcessors();
@@ -329,11 +610,13 @@ std::shared_ptr<OcioShader> CMS::getShader()
 
 const BaseStatus& CMS::getStatus()
 {
+    ensureInit();
     return S_STATUS;
 }
 
 void CMS::ensureOK()
 {
+    ensureInit();
     if (!S_STATUS.isOK())
         throw std::exception(strFormat("CMS failure: %s", S_STATUS.getError().c_str()).c_str());
 }
@@ -350,7 +633,12 @@ std::string CMS::resolveColorSpace(const std::string& name, bool preserve)
     if ((strLowercase(csName) == "working") || (strLowercase(csName) == "w"))
         csName = OCIO::ROLE_SCENE_LINEAR;
 
-    OCIO::ConstColorSpaceRcPtr cs = S_VARS.config->getColorSpace(csName.c_str());
+    // Null if the config couldn't be loaded
+    OCIO::ConstConfigRcPtr config = getConfig();
+    if (!config)
+        ensureOK();
+
+    OCIO::ConstColorSpaceRcPtr cs = config->getColorSpace(csName.c_str());
     if (cs.get())
     {
         csName = cs->getName();
@@ -6,6 +6,9 @@
 #include <array>
 #include <filesystem>
 #include <memory>
+#include <exception>
+#include <mutex>
+#include <unordered_map>
 
 #include <OpenColorIO/OpenColorIO.h>
 namespace OCIO = OpenColorIO_v2_1;
@@ -13,9 +16,12 @@ namespace OCIO = OpenColorIO_v2_1;
 #include "OcioShader.h"
 #include "../Utils/OpenGL/GlUtils.h"
 #include "../Utils/Status.h"
+#include "../Utils/LazyInit.h"
 #include "../Utils/Misc.h"
 #include "../CLI.h"
 
+class CmLut3D;
+
 // Color Management System (Global)
 class CMS
 {
@@ -24,6 +30,7 @@ public:
     CMS(const CMS&) = delete;
     CMS& operator= (const CMS&) = delete;
 
+    // Called on first use, calling it beforehand moves the cost up front
     static bool init();
     static void cleanUp();
 
@@ -56,6 +63,38 @@ public:
     static OCIO::ConstGPUProcessorRcPtr getGpuProcessor();
     static std::shared_ptr<OcioShader> getShader();
 
+    // The view transform can be baked into a 3D LUT for faster previews on
+    // the CPU, 0 disables it. Baked in updateProcessors(), null if disabled
+    // or if baking has failed. Baked LUTs are cached on disk, keyed by the
+    // content of the config files and the processor, so later runs with
+    // the same settings load them instead.
+    static uint32_t getViewLutSize();
+    static void setViewLutSize(uint32_t size);
+    static std::shared_ptr<const CmLut3D> getViewLut();
+
+    // Processor for converting between two color spaces of a config. The
+    // processors are cached by the config and the transform, since building
+    // them can take a while with configs that rely on LUTs. Thread-safe.
+    static OCIO::ConstCPUProcessorRcPtr getCpuProcessor(
+        OCIO::ConstConfigRcPtr config,
+        const std::string& src,
+        const std::string& dst);
+    static void clearProcessorCache();
+
+    // Applies a CPU processor to a packed RGB or RGBA buffer. Large images
+    // are split into one band of rows per thread, since CPU processors can
+    // be used from multiple threads.
+    static void applyCpuProcessor(
+        OCIO::ConstCPUProcessorRcPtr processor,
+        float* buffer,
+        uint32_t width,
+        uint32_t height,
+        uint32_t numChannels = 4);
+
+    // Smallest number of pixels to pass to applyCpuProcessor() at once for
+    // all the threads to be used
+    static uint32_t getParallelApplyPixels();
+
     static const BaseStatus& getStatus();
     static void ensureOK();
 
@@ -100,6 +139,13 @@ private:
         OCIO::ConstCPUProcessorRcPtr cpuProcessor;
         OCIO::ConstGPUProcessorRcPtr gpuProcessor;
 
+        // Content of the config files, computed when it's first needed
+        bool hasConfigHash = false;
+        uint64_t configHash = 0;
+
+        uint32_t viewLutSize = 0;
+        std::shared_ptr<const CmLut3D> viewLut;
+
         std::shared_ptr<OcioShader> shader;
 
         void retrieveColorSpaces();
@@ -110,6 +156,28 @@ private:
     static CmVars S_VARS;
     static BaseStatus S_STATUS;
 
+    static LazyInit S_INIT;
+    static void ensureInit();
+    static void initInternal();
+
     static void ensureProcessors();
 
+    struct CachedProcessor
+    {
+        OCIO::ConstProcessorRcPtr processor;
+        OCIO::ConstCPUProcessorRcPtr cpuProcessor;
+    };
+
+    // The key must describe the transform, the config is added to it
+    static std::unordered_map<std::string, CachedProcessor> S_PROCESSORS;
+    static std::mutex S_PROCESSORS_MUTEX;
+
+    static std::shared_ptr<const CmLut3D> loadOrBakeViewLut(const std::string& look);
+    static void pruneLutCache();
+
+    static CachedProcessor getCachedProcessor(
+        OCIO::ConstConfigRcPtr config,
+        const std::string& key,
+        OCIO::ConstTransformRcPtr transform);
+
 };
@@ -1,9 +1,18 @@
 #include "CmImage.h"
 
 std::shared_ptr<GlFramebuffer> CmImage::s_framebuffer = nullptr;
+std::atomic_uint64_t CmImage::s_generationCounter = 0;
+
+// Number of pixels transformed at once when updating a region (CPU), more
+// if needed to keep all the threads busy
+static constexpr uint32_t VIEW_BAND_PIXELS = 512 * 1024;
+
+// Smallest proxy is 1/64 of the size in each dimension
+static constexpr uint32_t MAX_PROXY_LEVEL = 6;
 
 CmImage::CmImage(const std::string& id, const std::string& name, uint32_t width, uint32_t height, std::array<float, 4> fillColor, bool useExposure, bool useGlobalFB)
-    : m_id(id), m_name(name), m_width(width), m_height(height), m_useExposure(useExposure), m_useGlobalFB(useGlobalFB)
+    : m_id(id), m_name(name), m_width(width), m_height(height), m_useExposure(useExposure), m_useGlobalFB(useGlobalFB),
+    m_imageData(std::make_shared<FloatBuffer>())
 {
     lock();
     resize(std::max(width, 1u), std::max(height, 1u), false);
@@ -48,19 +57,195 @@ uint32_t CmImage::getHeight() const
 
 uint32_t CmImage::getImageDataSize() const
 {
-    return m_imageData.size();
+    // The buffer might be packed
+    return m_width * m_height * 4;
 }
 
 float* CmImage::getImageData()
 {
-    return m_imageData.data();
+    return writableData().data();
 }
 
 std::vector<float>& CmImage::getImageDataVector()
 {
+    return writableData();
+}
+
+const float* CmImage::getConstImageData() const
+{
+    unpack();
+    return m_imageData->data();
+}
+
+const FloatBuffer& CmImage::getConstImageDataVector() const
+{
+    unpack();
+    return *m_imageData;
+}
+
+CmSharedBuffer CmImage::shareImageData() const
+{
+    unpack();
     return m_imageData;
 }
 
+void CmImage::setImageData(CmSharedBuffer buffer, uint32_t width, uint32_t height)
+{
+    if ((buffer.get() == nullptr) || (width < 1) || (height < 1) || (buffer->size() != ((size_t)width * (size_t)height * 4)))
+        throw std::exception(makeError(__FUNCTION__, "", "Invalid buffer size").c_str());
+
+    // Not written to while shared
+    m_imageData = std::const_pointer_cast<FloatBuffer>(buffer);
+    m_packedData = nullptr;
+    m_storageFormat = CmPixelFormat::RGBA32F;
+    m_width = width;
+    m_height = height;
+    bumpGeneration();
+}
+
+CmPixelFormat CmImage::getStorageFormat() const
+{
+    return m_storageFormat;
+}
+
+void CmImage::setStorageFormat(CmPixelFormat format, bool shouldLock)
+{
+    if (shouldLock) lock();
+
+    if (format != m_storageFormat)
+    {
+        unpack();
+        m_packedData = nullptr;
+        m_storageFormat = format;
+    }
+
+    if (shouldLock) unlock();
+}
+
+size_t CmImage::getStorageSize() const
+{
+    std::scoped_lock lock(m_cacheMutex);
+
+    // A wrapped buffer points into the packed one
+    size_t size = 0;
+    if (m_imageData && !m_imageData->isWrapped())
+        size += m_imageData->size() * sizeof(float);
+    if (m_packedData)
+        size += m_packedData->getSizeInBytes();
+    return size;
+}
+
+std::vector<float>& CmImage::writableData(bool keepContent)
+{
+    if (!m_imageData)
+    {
+        if (keepContent)
+            unpack();
+        else
+            m_imageData = std::make_shared<FloatBuffer>(m_width * m_height * 4);
+    }
+
+    if ((m_imageData.use_count() > 1) || m_imageData->isWrapped())
+    {
+        if (keepContent)
+            m_imageData = std::make_shared<FloatBuffer>(*m_imageData);
+        else
+            m_imageData = std::make_shared<FloatBuffer>(m_imageData->size());
+    }
+
+    // The packed copy is outdated from now on
+    m_packedData = nullptr;
+    return m_imageData->getVector();
+}
+
+void CmImage::unpack() const
+{
+    // Readers holding a shared lock might get here at the same time
+    std::scoped_lock lock(m_cacheMutex);
+
+    if (m_imageData || !m_packedData)
+        return;
+
+    // Same layout, the packed pixels are read in place until written to
+    if (m_packedData->getFormat() == CmPixelFormat::RGBA32F)
+    {
+        m_imageData = FloatBuffer::wrap(
+            m_packedData,
+            static_cast<const float*>(m_packedData->getData()),
+            (size_t)m_width * m_height * 4);
+        return;
+    }
+
+    std::shared_ptr<FloatBuffer> buffer = std::make_shared<FloatBuffer>(m_width * m_height * 4);
+    m_packedData->unpack(buffer->getVector().data());
+    m_imageData = buffer;
+}
+
+std::shared_ptr<const CmPixelBuffer> CmImage::sharePackedData() const
+{
+    return m_packedData;
+}
+
+void CmImage::setPackedData(std::shared_ptr<const CmPixelBuffer> buffer, uint64_t contentHash)
+{
+    if ((buffer.get() == nullptr) || (buffer->getWidth() < 1) || (buffer->getHeight() < 1))
+        throw std::exception(makeError(__FUNCTION__, "", "Invalid buffer").c_str());
+
+    m_imageData = nullptr;
+    m_packedData = buffer;
+    m_storageFormat = buffer->getFormat();
+    m_width = buffer->getWidth();
+    m_height = buffer->getHeight();
+    bumpGeneration();
+
+    if (contentHash != 0)
+    {
+        std::scoped_lock lock(m_cacheMutex);
+        m_contentHash = contentHash;
+        m_hashGeneration = m_generation;
+    }
+}
+
+uint64_t CmImage::getGeneration() const
+{
+    return m_generation;
+}
+
+uint64_t CmImage::getContentHash() const
+{
+    uint64_t generation = m_generation;
+    {
+        std::scoped_lock lock(m_cacheMutex);
+        if (m_hashGeneration == generation)
+            return m_contentHash;
+    }
+
+    // Writers are locked out, so the content matches the generation
+    uint64_t hash = hashContent(getConstImageData(), CmPixelFormat::RGBA32F, m_width, m_height);
+
+    {
+        std::scoped_lock lock(m_cacheMutex);
+        m_contentHash = hash;
+        m_hashGeneration = generation;
+    }
+    return hash;
+}
+
+uint64_t CmImage::hashContent(const void* data, CmPixelFormat format, uint32_t width, uint32_t height)
+{
+    Hasher hasher;
+    hasher.add(width).add(height);
+    if (format != CmPixelFormat::RGBA32F)
+        hasher.add(format);
+    hasher.addLarge(data, (size_t)width * height * getBytesPerPixel(format));
+    return hasher.get();
+}
+
+void CmImage::bumpGeneration()
+{
+    m_generation = ++s_generationCounter;
+}
+
 uint32_t CmImage::getGlTexture()
 {
     if (m_moveToGpu)
@@ -98,8 +283,74 @@ void CmImage::unlock()
     m_mutex.unlock();
 }
 
+void CmImage::lock_shared()
+{
+    m_mutex.lock_shared();
+}
+
+void CmImage::unlock_shared()
+{
+    m_mutex.unlock_shared();
+}
+
 void CmImage::moveToGPU()
 {
+    {
+        std::scoped_lock lock(m_dirtyMutex);
+        m_dirtyAll = true;
+    }
+    bumpGeneration();
+    m_moveToGpu = true;
+}
+
+void CmImage::moveToGPU(uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+{
+    if ((width < 1) || (height < 1))
+        return;
+
+    {
+        // Grow the dirty region to contain the new one
+        std::scoped_lock lock(m_dirtyMutex);
+        if ((m_dirtyX2 > m_dirtyX1) && (m_dirtyY2 > m_dirtyY1))
+        {
+            m_dirtyX1 = std::min(m_dirtyX1, x);
+            m_dirtyY1 = std::min(m_dirtyY1, y);
+            m_dirtyX2 = std::max(m_dirtyX2, x + width);
+            m_dirtyY2 = std::max(m_dirtyY2, y + height);
+        }
+        else
+        {
+            m_dirtyX1 = x;
+            m_dirtyY1 = y;
+            m_dirtyX2 = x + width;
+            m_dirtyY2 = y + height;
+        }
+    }
+    bumpGeneration();
+    m_moveToGpu = true;
+}
+
+void CmImage::updateView()
+{
+    {
+        std::scoped_lock lock(m_dirtyMutex);
+        m_viewChanged = true;
+    }
+    m_moveToGpu = true;
+}
+
+float CmImage::getDisplayScale() const
+{
+    return m_displayScale;
+}
+
+void CmImage::setDisplayScale(float scale)
+{
+    if (scale == m_displayScale)
+        return;
+
+    // The level is checked when the texture is requested
+    m_displayScale = scale;
     m_moveToGpu = true;
 }
 
@@ -107,24 +358,32 @@ void CmImage::resize(uint32_t newWidth, uint32_t newHeight, bool shouldLock)
 {
     if (shouldLock) lock();
 
-    if ((m_imageData.size() > 0) && (m_width == newWidth) && (m_height == newHeight))
+    if (newWidth < 1 || newHeight < 1)
     {
         if (shouldLock) unlock();
         return;
     }
 
-    if (newWidth < 1 || newHeight < 1)
+    // The content is about to be overwritten, writers that know it fits in
+    // a compact format set it afterwards
+    m_storageFormat = CmPixelFormat::RGBA32F;
+    m_packedData = nullptr;
+
+    // A shared or packed buffer is replaced even if the size is the same
+    bool reusable = m_imageData && (m_imageData->size() > 0) && (m_imageData.use_count() == 1) && !m_imageData->isWrapped();
+    if (reusable && (m_width == newWidth) && (m_height == newHeight))
     {
         if (shouldLock) unlock();
         return;
     }
 
-    clearVector(m_imageData);
-
     m_width = newWidth;
     m_height = newHeight;
 
-    m_imageData.resize(m_width * m_height * 4);
+    // Other holders of the old buffer keep it
+    m_imageData = std::make_shared<FloatBuffer>(m_width * m_height * 4);
+    m_packedData = nullptr;
+    bumpGeneration();
 
     if (shouldLock) unlock();
 }
@@ -135,7 +394,8 @@ void CmImage::reset(bool shouldLock)
 
     m_sourceName = "";
 
-    clearVector(m_imageData);
+    m_imageData = std::make_shared<FloatBuffer>();
+    m_packedData = nullptr;
     resize(1, 1, false);
 
     moveToGPU();
@@ -147,31 +407,37 @@ void CmImage::fill(std::array<float, 4> color, bool shouldLock)
 {
     if (shouldLock) lock();
 
-    for (size_t i = 0; i < m_imageData.size(); i += 4)
+    std::vector<float>& imageData = writableData(false);
+    for (size_t i = 0; i < imageData.size(); i += 4)
     {
-        m_imageData[i + 0] = color[0];
-        m_imageData[i + 1] = color[1];
-        m_imageData[i + 2] = color[2];
-        m_imageData[i + 3] = color[3];
+        imageData[i + 0] = color[0];
+        imageData[i + 1] = color[1];
+        imageData[i + 2] = color[2];
+        imageData[i + 3] = color[3];
     }
+    bumpGeneration();
 
     if (shouldLock) unlock();
 }
 
-void CmImage::fill(std::vector<float> buffer, bool shouldLock)
+void CmImage::fill(const std::vector<float>& buffer, bool shouldLock)
 {
     if (shouldLock) lock();
 
-    std::copy(buffer.data(), buffer.data() + std::min(m_imageData.size(), buffer.size()), m_imageData.data());
+    std::vector<float>& imageData = writableData(buffer.size() < getImageDataSize());
+    std::copy(buffer.data(), buffer.data() + std::min(imageData.size(), buffer.size()), imageData.data());
+    bumpGeneration();
 
     if (shouldLock) unlock();
 }
 
-void CmImage::fill(float* buffer, bool shouldLock)
+void CmImage::fill(const float* buffer, bool shouldLock)
 {
     if (shouldLock) lock();
 
-    std::copy(buffer, buffer + m_imageData.size(), m_imageData.data());
+    std::vector<float>& imageData = writableData(false);
+    std::copy(buffer, buffer + imageData.size(), imageData.data());
+    bumpGeneration();
 
     if (shouldLock) unlock();
 }
@@ -179,6 +445,7 @@ void CmImage::fill(float* buffer, bool shouldLock)
 void CmImage::renderUV()
 {
     std::scoped_lock lock(m_mutex);
+    std::vector<float>& imageData = writableData(false);
 
     int redIndex = 0;
     float u, v;
@@ -191,12 +458,13 @@ void CmImage::renderUV()
             v = ((float)y + 0.5f) / (float)m_height;
             v = 1 - v;
 
-            m_imageData[redIndex] = u;
-            m_imageData[redIndex + 1] = v;
-            m_imageData[redIndex + 2] = 0;
-            m_imageData[redIndex + 3] = 1;
+            imageData[redIndex] = u;
+            imageData[redIndex + 1] = v;
+            imageData[redIndex + 2] = 0;
+            imageData[redIndex + 3] = 1;
         }
     }
+    bumpGeneration();
 }
 
 void CmImage::moveContent(CmImage& target, bool copy)
@@ -207,14 +475,14 @@ void CmImage::moveContent(CmImage& target, bool copy)
     // Copy the source name
     target.m_sourceName = m_sourceName;
 
-    // Resize the target
-    target.resize(m_width, m_height, false);
-
-    // Move / Copy the buffer
-    if (copy)
-        target.m_imageData = m_imageData;
-    else
-        target.m_imageData = std::move(m_imageData);
+    // Share the buffer, no need to resize the target. The storage format
+    // goes with the content.
+    target.m_storageFormat = m_storageFormat;
+    target.m_packedData = m_packedData;
+    target.m_imageData = m_imageData;
+    target.m_width = m_width;
+    target.m_height = m_height;
+    target.bumpGeneration();
 
     // Reset self if moving
     if (!copy)
@@ -226,33 +494,312 @@ void CmImage::moveContent(CmImage& target, bool copy)
 
 void CmImage::moveToGPU_Internal()
 {
+    // Take the pending updates
+    bool dirtyAll, viewChanged;
+    uint32_t dirtyX1, dirtyY1, dirtyX2, dirtyY2;
+    {
+        std::scoped_lock lock(m_dirtyMutex);
+        dirtyAll = m_dirtyAll;
+        viewChanged = m_viewChanged;
+        dirtyX1 = m_dirtyX1;
+        dirtyY1 = m_dirtyY1;
+        dirtyX2 = m_dirtyX2;
+        dirtyY2 = m_dirtyY2;
+
+        m_dirtyAll = false;
+        m_viewChanged = false;
+        m_dirtyX1 = m_dirtyY1 = m_dirtyX2 = m_dirtyY2 = 0;
+    }
+
+    uint64_t generation;
+    {
+        // Only reads the content
+        std::shared_lock lock(m_mutex);
+        generation = m_generation;
+
+        const float exposure = m_useExposure ? CMS::getExposure() : 0.0f;
+        const bool gpuMode = CMS::usingGPU();
+        std::shared_ptr<GlFramebuffer>& framebuffer = m_useGlobalFB ? s_framebuffer : m_localFramebuffer;
+
+        const uint32_t level = calcProxyLevel();
+        uint32_t levelWidth, levelHeight;
+        getLevelSize(level, levelWidth, levelHeight);
+
+        // Partial updates build on the texture from the last update
+        const bool partial = !dirtyAll
+            && m_textureValid
+            && (m_textureGpuMode == gpuMode)
+            && (m_textureLevel == level)
+            && (m_texture.get() != nullptr)
+            && (m_texture->getWidth() == levelWidth)
+            && (m_texture->getHeight() == levelHeight);
+
+        // Region to update, everything for a full update
+        if (!partial)
+        {
+            dirtyX1 = 0;
+            dirtyY1 = 0;
+            dirtyX2 = m_width;
+            dirtyY2 = m_height;
+        }
+        dirtyX2 = std::min(dirtyX2, m_width);
+        dirtyY2 = std::min(dirtyY2, m_height);
+        const bool hasRegion = (dirtyX2 > dirtyX1) && (dirtyY2 > dirtyY1);
+
+        try
+        {
+            // From here on, the region is in the coordinates of the level
+            if (hasRegion)
+                updateProxies(level, dirtyX1, dirtyY1, dirtyX2, dirtyY2);
+
+            if (!partial)
+            {
+                // Apply View Transform
+                applyViewTransform(
+                    getLevelData(level),
+                    levelWidth,
+                    levelHeight,
+                    exposure,
+                    m_texture,
+                    framebuffer,
+                    !m_textureValid,
+                    true,
+                    false);
+            }
+            else if (gpuMode)
+            {
+                // The texture holds the content as is, and the transform
+                // only runs on the GPU.
+                if (hasRegion)
+                {
+                    m_texture->uploadRegion(
+                        getLevelData(level) + (((size_t)dirtyY1 * levelWidth + dirtyX1) * 4),
+                        dirtyX1, dirtyY1, dirtyX2 - dirtyX1, dirtyY2 - dirtyY1, levelWidth);
+                }
+                if (hasRegion || viewChanged)
+                    transformGPU(*m_texture, framebuffer, exposure, false);
+            }
+            else if (viewChanged)
+            {
+                // Everything has to be transformed again. The content hasn't
+                // changed, so if it's packed, it's read from the packed
+                // buffer instead of being unpacked as a whole.
+                std::shared_ptr<const CmPixelBuffer> packedData = nullptr;
+                if (level == 0)
+                {
+                    std::scoped_lock cacheLock(m_cacheMutex);
+                    if (!m_imageData)
+                        packedData = m_packedData;
+                }
+
+                if (packedData)
+                    transformRegionCPU(nullptr, packedData.get(), levelWidth, 0, 0, levelWidth, levelHeight, exposure, *m_texture);
+                else
+                    transformRegionCPU(getLevelData(level), nullptr, levelWidth, 0, 0, levelWidth, levelHeight, exposure, *m_texture);
+            }
+            else if (hasRegion)
+            {
+                transformRegionCPU(
+                    getLevelData(level), nullptr, levelWidth,
+                    dirtyX1, dirtyY1, dirtyX2 - dirtyX1, dirtyY2 - dirtyY1,
+                    exposure, *m_texture);
+            }
+
+            m_textureValid = true;
+            m_textureGpuMode = gpuMode;
+            m_textureLevel = level;
+        }
+        catch (const std::exception& e)
+        {
+            printError(__FUNCTION__, "", e.what());
+            m_textureValid = false;
+        }
+    }
+
+    // Keep the compact version only, unless the content has changed since,
+    // in which case it's moved to the GPU again
     std::scoped_lock lock(m_mutex);
+    if ((m_storageFormat != CmPixelFormat::RGBA32F) && (m_generation == generation) && m_imageData)
+    {
+        if (!m_packedData)
+        {
+            m_packedData = CmPixelBuffer::pack(m_imageData->data(), m_width, m_height, m_storageFormat);
 
-    // Apply View Transform
-    static bool lastResult = false;
-    try
+            // Packing can round the pixels, the hash of the unpacked ones
+            // might not match anymore
+            std::scoped_lock cacheLock(m_cacheMutex);
+            m_hashGeneration = 0;
+        }
+        m_imageData = nullptr;
+    }
+}
+
+uint32_t CmImage::calcProxyLevel() const
+{
+    // Halve the size while the proxy would still be displayed at full
+    // resolution or larger
+    uint32_t level = 0;
+    float scale = m_displayScale;
+    uint32_t width = m_width, height = m_height;
+    while ((scale <= 0.5f) && (level < MAX_PROXY_LEVEL) && (width > 1) && (height > 1))
     {
-        applyViewTransform(
-            m_imageData.data(),
-            m_width,
-            m_height,
-            m_useExposure ? CMS::getExposure() : 0.0f,
-            m_texture,
-            m_useGlobalFB ? s_framebuffer : m_localFramebuffer,
-            !lastResult,
-            true,
-            false);
-        lastResult = true;
+        scale *= 2.0f;
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+        level++;
     }
-    catch (const std::exception& e)
+    return level;
+}
+
+void CmImage::getLevelSize(uint32_t level, uint32_t& outWidth, uint32_t& outHeight) const
+{
+    outWidth = m_width;
+    outHeight = m_height;
+    for (uint32_t i = 0; i < level; i++)
     {
-        printError(__FUNCTION__, "", e.what());
-        lastResult = false;
+        outWidth = (outWidth + 1) / 2;
+        outHeight = (outHeight + 1) / 2;
+    }
+}
+
+const float* CmImage::getLevelData(uint32_t level) const
+{
+    if (level > 0)
+        return m_proxies[level - 1].data();
+    return getConstImageData();
+}
+
+// 2x2 box filter over a region of the target. The last row and column of a
+// source with an odd size are repeated.
+static void downsampleRegion(
+    const float* source,
+    uint32_t sourceWidth,
+    uint32_t sourceHeight,
+    float* target,
+    uint32_t targetWidth,
+    uint32_t x1,
+    uint32_t y1,
+    uint32_t x2,
+    uint32_t y2)
+{
+#pragma omp parallel for
+    for (int y = (int)y1; y < (int)y2; y++)
+    {
+        const float* row0 = source + ((size_t)std::min((uint32_t)y * 2, sourceHeight - 1) * sourceWidth * 4);
+        const float* row1 = source + ((size_t)std::min(((uint32_t)y * 2) + 1, sourceHeight - 1) * sourceWidth * 4);
+        float* targetRow = target + ((size_t)y * targetWidth * 4);
+
+        for (uint32_t x = x1; x < x2; x++)
+        {
+            uint32_t sx0 = std::min(x * 2, sourceWidth - 1) * 4;
+            uint32_t sx1 = std::min((x * 2) + 1, sourceWidth - 1) * 4;
+            for (uint32_t c = 0; c < 4; c++)
+                targetRow[(x * 4) + c] = 0.25f * (row0[sx0 + c] + row0[sx1 + c] + row1[sx0 + c] + row1[sx1 + c]);
+        }
+    }
+}
+
+void CmImage::updateProxies(uint32_t level, uint32_t& x1, uint32_t& y1, uint32_t& x2, uint32_t& y2)
+{
+    // Levels above the current one would go out of sync
+    m_proxies.resize(level);
+
+    uint32_t sourceWidth = m_width, sourceHeight = m_height;
+    for (uint32_t i = 0; i < level; i++)
+    {
+        const float* source = getLevelData(i);
+        uint32_t targetWidth = (sourceWidth + 1) / 2;
+        uint32_t targetHeight = (sourceHeight + 1) / 2;
+
+        // Pixels that cover any part of the region
+        x1 /= 2;
+        y1 /= 2;
+        x2 = (x2 + 1) / 2;
+        y2 = (y2 + 1) / 2;
+
+        // New levels are made from scratch
+        PooledVector<float>& proxy = m_proxies[i];
+        if (proxy.size() != ((size_t)targetWidth * (size_t)targetHeight * 4))
+        {
+            proxy.resize((size_t)targetWidth * (size_t)targetHeight * 4);
+            x1 = 0;
+            y1 = 0;
+            x2 = targetWidth;
+            y2 = targetHeight;
+        }
+
+        downsampleRegion(source, sourceWidth, sourceHeight, proxy.data(), targetWidth, x1, y1, x2, y2);
+
+        sourceWidth = targetWidth;
+        sourceHeight = targetHeight;
+    }
+}
+
+void CmImage::transformRegionCPU(
+    const float* buffer,
+    const CmPixelBuffer* packedBuffer,
+    uint32_t bufferWidth,
+    uint32_t x,
+    uint32_t y,
+    uint32_t width,
+    uint32_t height,
+    float exposure,
+    GlTexture& texture)
+{
+    CMS::ensureOK();
+    OCIO::ConstCPUProcessorRcPtr processor = CMS::getCpuProcessor();
+    std::shared_ptr<const CmLut3D> lut = CMS::getViewLut();
+
+    const float expMul = getExposureMul(exposure);
+    const uint32_t bandPixels = std::max(VIEW_BAND_PIXELS, CMS::getParallelApplyPixels());
+    const uint32_t bandHeight = std::max(bandPixels / width, 1u);
+    PooledVector<float> band((size_t)width * std::min(bandHeight, height) * 4);
+
+    // Whole rows of the packed buffer
+    PooledVector<float> unpacked;
+    if (!buffer)
+        unpacked.resize((size_t)bufferWidth * std::min(bandHeight, height) * 4);
+
+    for (uint32_t bandY = 0; bandY < height; bandY += bandHeight)
+    {
+        const uint32_t numRows = std::min(bandHeight, height - bandY);
+        if (!buffer)
+            packedBuffer->unpackRows(y + bandY, numRows, unpacked.data());
+
+        // Copy with the exposure applied
+        for (uint32_t row = 0; row < numRows; row++)
+        {
+            const float* source = buffer
+                ? (buffer + ((((size_t)(y + bandY + row) * bufferWidth) + x) * 4))
+                : (unpacked.data() + ((((size_t)row * bufferWidth) + x) * 4));
+            float* target = band.data() + ((size_t)row * width * 4);
+            for (uint32_t i = 0; i < width * 4; i += 4)
+            {
+                target[i + 0] = source[i + 0] * expMul;
+                target[i + 1] = source[i + 1] * expMul;
+                target[i + 2] = source[i + 2] * expMul;
+                target[i + 3] = source[i + 3];
+            }
+        }
+
+        try
+        {
+            if (lut)
+                lut->apply(band.data(), width, numRows);
+            else
+                CMS::applyCpuProcessor(processor, band.data(), width, numRows);
+        }
+        catch (std::exception& e)
+        {
+            throw std::exception(makeError(__FUNCTION__, "Color Transform (CPU)", e.what()).c_str());
+        }
+
+        texture.uploadRegion(band.data(), x, y + bandY, width, numRows, width);
     }
 }
 
 void CmImage::applyViewTransform(
-    float* buffer,
+    const float* buffer,
     uint32_t width,
     uint32_t height,
     float exposure,
@@ -282,26 +829,23 @@ void CmImage::applyViewTransform(
     // Color Transform (CPU)
     if (!gpuMode)
     {
+        // Copy with the exposure applied
         transBuffer.resize(size);
-        std::copy(buffer, buffer + size, transBuffer.data());
-
-        if (exposure != 0.0f)
-            for (uint32_t i = 0; i < size; i++)
-                if (i % 4 != 3) transBuffer[i] *= expMul;
+        for (uint32_t i = 0; i < size; i += 4)
+        {
+            transBuffer[i + 0] = buffer[i + 0] * expMul;
+            transBuffer[i + 1] = buffer[i + 1] * expMul;
+            transBuffer[i + 2] = buffer[i + 2] * expMul;
+            transBuffer[i + 3] = buffer[i + 3];
+        }
 
         try
         {
-            OCIO::PackedImageDesc img(
-                transBuffer.data(),
-                width,
-                height,
-                OCIO::ChannelOrdering::CHANNEL_ORDERING_RGBA,
-                OCIO::BitDepth::BIT_DEPTH_F32,
-                4,                 // 4 bytes to go to the next color channel
-                4 * 4,             // 4 color channels * 4 bytes per channel (till the next pixel)
-                width * 4 * 4);  // width * 4 channels * 4 bytes (till the next row)
-
-            CMS::getCpuProcessor()->apply(img);
+            std::shared_ptr<const CmLut3D> lut = CMS::getViewLut();
+            if (lut)
+                lut->apply(transBuffer.data(), width, height);
+            else
+                CMS::applyCpuProcessor(CMS::getCpuProcessor(), transBuffer.data(), width, height);
         }
         catch (std::exception& e)
         {
@@ -352,68 +896,7 @@ void CmImage::applyViewTransform(
 
     // Color Transform (GPU)
     if (gpuMode)
-    {
-        try
-        {
-            // Recreate the framebuffer if needed
-            {
-                bool mustRecreate = false;
-
-                if (framebuffer.get() == nullptr)
-                    mustRecreate = true;
-                else if ((framebuffer->getWidth() != width) || (framebuffer->getHeight() != height))
-                    mustRecreate = true;
-
-                mustRecreate |= recreate;
-
-                if (mustRecreate)
-                {
-                    framebuffer = std::make_shared<GlFramebuffer>(width, height);
-                }
-            }
-
-            // Bind the framebuffer so we can render the transformed image into it
-            framebuffer->bind();
-
-            // Set the viewport
-            framebuffer->viewport();
-
-            // Use the shader program
-            std::shared_ptr<OcioShader> shader = CMS::getShader();
-            shader->useProgram();
-
-            // Configure the input textures and uniforms
-            texture->bind(GL_TEXTURE0);
-            shader->setInputTexture(0);
-            shader->setExposureMul(expMul);
-
-            // Use the LUTs and uniforms associated with the shader
-            shader->useLuts();
-            shader->useUniforms();
-
-            // Clear the buffer
-            glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-            glClear(GL_COLOR_BUFFER_BIT);
-            checkGlStatus("", "Clear");
-
-            // Draw
-            {
-                GlFullPlaneVertices::enable(shader->getProgram());
-
-                glDrawArrays(GL_TRIANGLES, 0, 6);
-                checkGlStatus("", "glDrawArrays");
-
-                GlFullPlaneVertices::disable(shader->getProgram());
-            }
-
-            // Unbind the framebuffer
-            framebuffer->unbind();
-        }
-        catch (const std::exception& e)
-        {
-            throw std::exception(makeError(__FUNCTION__, "Color Transform (GPU)", e.what()).c_str());
-        }
-    }
+        transformGPU(*texture, framebuffer, exposure, recreate);
 
     // Read back the result
 
@@ -441,6 +924,77 @@ void CmImage::applyViewTransform(
     }
 }
 
+void CmImage::transformGPU(
+    GlTexture& texture,
+    std::shared_ptr<GlFramebuffer>& framebuffer,
+    float exposure,
+    bool recreate)
+{
+    const uint32_t width = texture.getWidth();
+    const uint32_t height = texture.getHeight();
+
+    try
+    {
+        // Recreate the framebuffer if needed
+        {
+            bool mustRecreate = false;
+
+            if (framebuffer.get() == nullptr)
+                mustRecreate = true;
+            else if ((framebuffer->getWidth() != width) || (framebuffer->getHeight() != height))
+                mustRecreate = true;
+
+            mustRecreate |= recreate;
+
+            if (mustRecreate)
+            {
+                framebuffer = std::make_shared<GlFramebuffer>(width, height);
+            }
+        }
+
+        // Bind the framebuffer so we can render the transformed image into it
+        framebuffer->bind();
+
+        // Set the viewport
+        framebuffer->viewport();
+
+        // Use the shader program
+        std::shared_ptr<OcioShader> shader = CMS::getShader();
+        shader->useProgram();
+
+        // Configure the input textures and uniforms
+        texture.bind(GL_TEXTURE0);
+        shader->setInputTexture(0);
+        shader->setExposureMul(getExposureMul(exposure));
+
+        // Use the LUTs and uniforms associated with the shader
+        shader->useLuts();
+        shader->useUniforms();
+
+        // Clear the buffer
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        checkGlStatus("", "Clear");
+
+        // Draw
+        {
+            GlFullPlaneVertices::enable(shader->getProgram());
+
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+            checkGlStatus("", "glDrawArrays");
+
+            GlFullPlaneVertices::disable(shader->getProgram());
+        }
+
+        // Unbind the framebuffer
+        framebuffer->unbind();
+    }
+    catch (const std::exception& e)
+    {
+        throw std::exception(makeError(__FUNCTION__, "Color Transform (GPU)", e.what()).c_str());
+    }
+}
+
 void CmImage::cleanUp()
 {
     s_framebuffer = nullptr;
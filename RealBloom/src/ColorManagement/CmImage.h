@@ -2,9 +2,11 @@
 
 #include <string>
 #include <mutex>
+#include <shared_mutex>
 #include <array>
 #include <vector>
 #include <memory>
+#include <atomic>
 #include <cstdint>
 
 #ifndef GLEW_STATIC
@@ -13,6 +15,8 @@
 #include <GL/glew.h>
 
 #include "CMS.h"
+#include "CmLut3D.h"
+#include "CmPixelBuffer.h"
 #include "OcioShader.h"
 
 #include "../Utils/OpenGL/GlTexture.h"
@@ -23,10 +27,17 @@
 #include "../Utils/OpenGL/GlUtils.h"
 
 #include "../Utils/NumberHelpers.h"
+#include "../Utils/Hash.h"
+#include "../Utils/BufferPool.h"
+#include "../Utils/FloatBuffer.h"
 #include "../Utils/Misc.h"
 
+// Read-only pixel buffer that can be shared between images and modules
+typedef std::shared_ptr<const FloatBuffer> CmSharedBuffer;
+
 // Color-Managed Image
-// Internal format is always RGBA32F
+// Pixels are accessed as RGBA32F, but can be stored in a more compact
+// format when the image isn't being worked on.
 class CmImage
 {
 public:
@@ -54,24 +65,91 @@ public:
     uint32_t getImageDataSize() const;
 
     // RGBA. Every 4 elements represent a pixel.
+    // The buffer might be shared, in which case it's copied before it can
+    // be written to. Use the const versions for reading.
     float* getImageData();
     std::vector<float>& getImageDataVector();
+    const float* getConstImageData() const;
+    const FloatBuffer& getConstImageDataVector() const;
+
+    // Share the buffer without copying, call while locked.
+    // setImageData() resets the storage format. Content packed as RGBA32F
+    // is read in place, so a buffer might point into a mapped file.
+    CmSharedBuffer shareImageData() const;
+    void setImageData(CmSharedBuffer buffer, uint32_t width, uint32_t height);
+
+    // Format of the image at rest. The content is packed after being moved
+    // to the GPU, and unpacked to RGBA32F when it's accessed again. Set by
+    // the writer after resizing, when the content fits in the format. The
+    // format is only set for the final content, progress snapshots stay in
+    // RGBA32F so the buffer isn't packed and reallocated on every update.
+    CmPixelFormat getStorageFormat() const;
+    void setStorageFormat(CmPixelFormat format, bool shouldLock);
+
+    // Memory used by the pixels in bytes, call while locked
+    size_t getStorageSize() const;
+
+    // The content in the storage format, without unpacking or copying it.
+    // sharePackedData() returns null if the content isn't packed at the
+    // moment. setPackedData() also sets the storage format, the pixels are
+    // unpacked when they're accessed. contentHash is the hash of the
+    // content if it's known, 0 otherwise. Call while locked.
+    std::shared_ptr<const CmPixelBuffer> sharePackedData() const;
+    void setPackedData(std::shared_ptr<const CmPixelBuffer> buffer, uint64_t contentHash = 0);
 
     GLuint getGlTexture();
 
+    // Changes whenever the content might have changed, and is never reused
+    // by another image. Code that writes to the buffer directly must call
+    // moveToGPU() afterwards.
+    uint64_t getGeneration() const;
+
+    // Hash of the dimensions and the pixels, computed on request and kept
+    // until the generation changes. Call while locked.
+    uint64_t getContentHash() const;
+
+    // Content hash of pixels in a storage format. Same as getContentHash()
+    // for RGBA32F, the other formats are hashed as packed.
+    static uint64_t hashContent(const void* data, CmPixelFormat format, uint32_t width, uint32_t height);
+
+    // Exclusive for writing, shared for reading.
+    // Works with std::scoped_lock and std::shared_lock.
     void lock();
     void unlock();
+    void lock_shared();
+    void unlock_shared();
 
+    // The view transform is applied when the texture is requested.
+    // moveToGPU(x, y, width, height): Only the region has changed since the
+    // last call, it's the only part that gets transformed and uploaded. Used
+    // by writers that know which part they've changed, like the progress
+    // snapshots of naive convolution.
+    // updateView(): The content hasn't changed but the view settings or the
+    // exposure have, the content isn't uploaded again in GPU mode.
     void moveToGPU();
+    void moveToGPU(uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+    void updateView();
+
+    // Scale at which the texture is displayed. At half the size or below,
+    // the view transform runs on a downsampled proxy of the content, so only
+    // about as many pixels as can be seen are transformed and uploaded. The
+    // texture is then smaller than the image. Full resolution is restored
+    // the next time the texture is requested after zooming back in.
+    float getDisplayScale() const;
+    void setDisplayScale(float scale);
 
+    // The content is kept only if the size doesn't change and the buffer
+    // isn't shared or packed. Resets the storage format.
     void resize(uint32_t newWidth, uint32_t newHeight, bool shouldLock);
     void reset(bool shouldLock);
 
     void fill(std::array<float, 4> color, bool shouldLock);
-    void fill(std::vector<float> buffer, bool shouldLock);
-    void fill(float* buffer, bool shouldLock);
+    void fill(const std::vector<float>& buffer, bool shouldLock);
+    void fill(const float* buffer, bool shouldLock);
     void renderUV();
 
+    // The buffer and the storage format are shared with the target in both
+    // cases, copying only happens when one of the images is written to.
     void moveContent(CmImage& target, bool copy);
 
     /// <summary>
@@ -88,7 +166,7 @@ public:
     /// <param name="readback">Read back the result to outBuffer</param>
     /// <param name="outBuffer">Buffer for storing the result</param>
     static void applyViewTransform(
-        float* buffer,
+        const float* buffer,
         uint32_t width,
         uint32_t height,
         float exposure,
@@ -110,9 +188,26 @@ private:
     bool m_useExposure = true;
     bool m_useGlobalFB = true;
 
-    std::vector<float> m_imageData;
+    // Null while the image is only stored packed
+    mutable std::shared_ptr<FloatBuffer> m_imageData;
+    std::atomic_uint64_t m_generation = 0;
+    static std::atomic_uint64_t s_generationCounter;
+    void bumpGeneration();
+
+    // Guards what readers fill in lazily while holding a shared lock
+    mutable std::mutex m_cacheMutex;
+    mutable uint64_t m_hashGeneration = 0;
+    mutable uint64_t m_contentHash = 0;
+
+    // Null if it doesn't match the content
+    CmPixelFormat m_storageFormat = CmPixelFormat::RGBA32F;
+    std::shared_ptr<const CmPixelBuffer> m_packedData = nullptr;
+
+    // Makes sure the buffer isn't shared before writing
+    std::vector<float>& writableData(bool keepContent = true);
+    void unpack() const;
 
-    std::mutex m_mutex;
+    std::shared_mutex m_mutex;
 
     uint32_t m_oldWidth = 0, m_oldHeight = 0;
     std::shared_ptr<GlTexture> m_texture = nullptr;
@@ -123,4 +218,52 @@ private:
     bool m_moveToGpu = true;
     void moveToGPU_Internal();
 
+    // Pending texture updates, the dirty region is [x1, x2) x [y1, y2)
+    std::mutex m_dirtyMutex;
+    bool m_dirtyAll = true;
+    bool m_viewChanged = false;
+    uint32_t m_dirtyX1 = 0, m_dirtyY1 = 0, m_dirtyX2 = 0, m_dirtyY2 = 0;
+
+    // Whether the texture (and the framebuffer in GPU mode) hold the result
+    // of the last update, so that the next one can build on it
+    bool m_textureValid = false;
+    bool m_textureGpuMode = false;
+
+    // Display-resolution proxies, each level is half the size of the one
+    // before, level 0 being the content itself. Only used by the thread that
+    // owns the texture, which keeps them in sync with the dirty regions.
+    float m_displayScale = 1.0f;
+    uint32_t m_textureLevel = 0;
+    std::vector<PooledVector<float>> m_proxies;
+
+    uint32_t calcProxyLevel() const;
+    void getLevelSize(uint32_t level, uint32_t& outWidth, uint32_t& outHeight) const;
+    const float* getLevelData(uint32_t level) const;
+
+    // Brings the levels up to the given one in sync with a region of the
+    // content, and converts the region to the coordinates of that level.
+    // Call while locked.
+    void updateProxies(uint32_t level, uint32_t& x1, uint32_t& y1, uint32_t& x2, uint32_t& y2);
+
+    // Applies the view transform (CPU) to a region of the buffer in bands of
+    // rows and uploads it to the same region of the texture. If buffer is
+    // null, the rows are unpacked from packedBuffer one band at a time.
+    static void transformRegionCPU(
+        const float* buffer,
+        const CmPixelBuffer* packedBuffer,
+        uint32_t bufferWidth,
+        uint32_t x,
+        uint32_t y,
+        uint32_t width,
+        uint32_t height,
+        float exposure,
+        GlTexture& texture);
+
+    // Renders the texture into the framebuffer through the OCIO shader
+    static void transformGPU(
+        GlTexture& texture,
+        std::shared_ptr<GlFramebuffer>& framebuffer,
+        float exposure,
+        bool recreate);
+
 };
@@ -1,11 +1,45 @@
 #include "CmImageIO.h"
 
+#include <cstring>
+
+#include "../Utils/Random.h"
+
 CmImageIO::CmImageIoVars CmImageIO::S_VARS;
+LazyInit CmImageIO::S_INIT("Color Managed Image IO");
+std::list<std::shared_ptr<CmImageIO::CacheEntry>> CmImageIO::S_CACHE;
+std::mutex CmImageIO::S_CACHE_MUTEX;
 
 static const std::string attribNameColorSpace = "colorspace";
 
+// Values of the "compression" attribute, in the order of ExrCompression
+static const char* exrCompressionAttribs[] = { "none", "zip", "piz", "dwaa" };
+
+// Native format: a header, the name of the color space, and the packed
+// pixels starting at an aligned offset
+static constexpr uint32_t NATIVE_MAGIC = 0x4D494252; // "RBIM"
+static constexpr uint32_t NATIVE_VERSION = 1;
+static constexpr uint64_t NATIVE_HEADER_SIZE = 48;
+static constexpr uint64_t NATIVE_ALIGNMENT = 64;
+
+// Images are decoded and converted in bands of at least this many pixels,
+// more if needed to keep all the threads busy while converting
+static constexpr uint32_t READ_BAND_PIXELS = 256 * 1024;
+
+void CmImageIO::ensureInit()
+{
+    S_INIT.ensure(initInternal);
+}
+
 void CmImageIO::init()
 {
+    ensureInit();
+}
+
+void CmImageIO::initInternal()
+{
+    // OpenEXR compresses blocks of scanlines on its own thread pool
+    OIIO::attribute("exr_threads", (int)getMaxNumThreads());
+
     // Default values
     S_VARS.inputSpace = CMS::getWorkingSpace();
     S_VARS.outputSpace = S_VARS.inputSpace;
@@ -15,6 +49,10 @@ void CmImageIO::init()
     OCIO::ConstConfigRcPtr config = CMS::getConfig();
     const std::vector<std::string>& userSpaces = CMS::getColorSpaces();
 
+    // The config couldn't be loaded
+    if (!config)
+        return;
+
     // Find the appropriate color space for linear image files (OpenEXR, HDR, etc.)
     if (config->hasRole("default_float"))
     {
@@ -56,59 +94,139 @@ void CmImageIO::init()
 
 void CmImageIO::cleanUp()
 {
-    //
+    clearCache();
 }
 
 const std::string& CmImageIO::getInputSpace()
 {
+    ensureInit();
     return S_VARS.inputSpace;
 }
 
 const std::string& CmImageIO::getOutputSpace()
 {
+    ensureInit();
     return S_VARS.outputSpace;
 }
 
 const std::string& CmImageIO::getNonLinearSpace()
 {
+    ensureInit();
     return S_VARS.nonLinearSpace;
 }
 
 bool CmImageIO::getAutoDetect()
 {
+    ensureInit();
     return S_VARS.autoDetect;
 }
 
 bool CmImageIO::getApplyViewTransform()
 {
+    ensureInit();
     return S_VARS.applyViewTransform;
 }
 
 void CmImageIO::setInputSpace(const std::string& colorSpace)
 {
+    ensureInit();
     S_VARS.inputSpace = colorSpace;
 }
 
 void CmImageIO::setOutputSpace(const std::string& colorSpace)
 {
+    ensureInit();
     S_VARS.outputSpace = colorSpace;
 }
 
 void CmImageIO::setNonLinearSpace(const std::string& colorSpace)
 {
+    ensureInit();
     S_VARS.nonLinearSpace = colorSpace;
 }
 
 void CmImageIO::setAutoDetect(bool autoDetect)
 {
+    ensureInit();
     S_VARS.autoDetect = autoDetect;
 }
 
 void CmImageIO::setApplyViewTransform(bool applyViewTransform)
 {
+    ensureInit();
     S_VARS.applyViewTransform = applyViewTransform;
 }
 
+bool CmImageIO::getExrHalf()
+{
+    ensureInit();
+    return S_VARS.exrHalf;
+}
+
+bool CmImageIO::getRgbOnly()
+{
+    ensureInit();
+    return S_VARS.rgbOnly;
+}
+
+ExrCompression CmImageIO::getExrCompression()
+{
+    ensureInit();
+    return S_VARS.exrCompression;
+}
+
+void CmImageIO::setExrHalf(bool exrHalf)
+{
+    ensureInit();
+    S_VARS.exrHalf = exrHalf;
+}
+
+void CmImageIO::setRgbOnly(bool rgbOnly)
+{
+    ensureInit();
+    S_VARS.rgbOnly = rgbOnly;
+}
+
+void CmImageIO::setExrCompression(ExrCompression exrCompression)
+{
+    ensureInit();
+    S_VARS.exrCompression = exrCompression;
+}
+
+uint64_t CmImageIO::getCacheBudget()
+{
+    return S_VARS.cacheBudget;
+}
+
+void CmImageIO::setCacheBudget(uint64_t budget)
+{
+    S_VARS.cacheBudget = budget;
+
+    std::scoped_lock lock(S_CACHE_MUTEX);
+    cacheTrim();
+}
+
+uint64_t CmImageIO::getCacheUsage()
+{
+    std::scoped_lock lock(S_CACHE_MUTEX);
+    uint64_t usage = 0;
+    for (const auto& entry : S_CACHE)
+        usage += entry->buffer->size() * sizeof(float);
+    return usage;
+}
+
+uint32_t CmImageIO::getCacheCount()
+{
+    std::scoped_lock lock(S_CACHE_MUTEX);
+    return S_CACHE.size();
+}
+
+void CmImageIO::clearCache()
+{
+    std::scoped_lock lock(S_CACHE_MUTEX);
+    S_CACHE.clear();
+}
+
 std::string makeIoError(const std::string& message, bool hasError, const std::string& error)
 {
     if (hasError)
@@ -117,8 +235,9 @@ std::string makeIoError(const std::string& message, bool hasError, const std::st
         return strFormat("%s.", message.c_str());
 }
 
-void CmImageIO::readImage(CmImage& target, const std::string& filename)
+void CmImageIO::readImage(CmImage& target, const std::string& filename, ImageTransformParams* transformParams, bool useCache)
 {
+    ensureInit();
     try
     {
         if (filename.empty())
@@ -127,6 +246,13 @@ void CmImageIO::readImage(CmImage& target, const std::string& filename)
         // Get the extension
         std::string extension = getFileExtension(filename);
 
+        // Native images don't go through OIIO
+        if (contains(getNativeExtensions(), extension))
+        {
+            readNative(target, filename);
+            return;
+        }
+
         // Determine the color space
         std::string csName;
         if (contains(getLinearExtensions(), extension))
@@ -142,6 +268,23 @@ void CmImageIO::readImage(CmImage& target, const std::string& filename)
             throw std::exception(strFormat("File extension \"%s\" isn't supported.", extension.c_str()).c_str());
         }
 
+        // Share the buffer of an earlier read
+        uint64_t key = useCache ? cacheKey(filename, csName, transformParams) : 0;
+        if (std::shared_ptr<CacheEntry> entry = cacheFind(key))
+        {
+            if (transformParams)
+                transformParams->cropResize = entry->cropResize;
+
+            {
+                std::scoped_lock lock(target);
+                target.setImageData(entry->buffer, entry->width, entry->height);
+            }
+            target.moveToGPU();
+
+            target.setSourceName(std::filesystem::path(filename).filename().string());
+            return;
+        }
+
         // Open the file
         OIIO::ImageInput::unique_ptr inp = OIIO::ImageInput::open(filename);
         if (!inp)
@@ -149,10 +292,8 @@ void CmImageIO::readImage(CmImage& target, const std::string& filename)
             throw std::exception(strFormat("Couldn't open input file \"%s\".", filename.c_str()).c_str());
         }
 
-        // Read the specs
+        // Read the specs, the reference changes when seeking to another level
         const OIIO::ImageSpec& spec = inp->spec();
-        uint32_t width = spec.width;
-        uint32_t height = spec.height;
         uint32_t channels = spec.nchannels;
 
         // Attempt to read the color space name
@@ -180,115 +321,661 @@ void CmImageIO::readImage(CmImage& target, const std::string& filename)
             throw std::exception(strFormat("Input image must have 1, 3, or 4 color channels, not %d.", channels).c_str());
         }
 
-        // Prepare buffer
-        std::vector<float> buffer;
-        buffer.resize(width * height * channels);
+        // Decide what to decode
+        ReadRegion region;
+        region.width = spec.width;
+        region.height = spec.height;
+        if (transformParams)
+            region = planRead(*inp, *transformParams);
+
+        uint32_t width = region.width / region.factorX;
+        uint32_t height = region.height / region.factorY;
 
-        // Read into the buffer
-        if (!inp->read_image(0, 0, 0, -1, OIIO::TypeDesc::FLOAT, buffer.data()))
+        // Read and convert into the buffer that becomes the image's storage
+        std::shared_ptr<FloatBuffer> buffer = std::make_shared<FloatBuffer>();
+        try
+        {
+            // Color Space Conversion
+            OCIO::ConstCPUProcessorRcPtr cpuProc = nullptr;
+            if (channels > 1)
+            {
+                CMS::ensureOK();
+                cpuProc = CMS::getCpuProcessor(CMS::getConfig(), csName, OCIO::ROLE_SCENE_LINEAR);
+            }
+
+            readPixels(*inp, region, cpuProc, filename, buffer->getVector());
+        }
+        catch (OCIO::Exception& e)
         {
             inp->close();
-            throw std::exception(makeIoError(
-                strFormat("Couldn't read image from file \"%s\"", filename.c_str()),
-                inp->has_error(),
-                inp->geterror()
-            ).c_str());
+            throw std::exception(strFormat("OpenColorIO Error: %s", e.what()).c_str());
+        }
+        catch (const std::exception&)
+        {
+            inp->close();
+            throw;
         }
         inp->close();
 
-        // Convert to RGBA
-        std::vector<float> bufferRGBA;
-        bufferRGBA.resize(width * height * 4);
-        if (channels == 4)
-            std::copy(buffer.data(), buffer.data() + buffer.size(), bufferRGBA.data());
-        else if (channels == 3)
+        // Keep it for the next reads
+        if (key != 0)
+        {
+            std::shared_ptr<CacheEntry> entry = std::make_shared<CacheEntry>();
+            entry->key = key;
+            entry->buffer = buffer;
+            entry->width = width;
+            entry->height = height;
+            if (transformParams)
+                entry->cropResize = transformParams->cropResize;
+            cacheInsert(entry);
+        }
+
+        // Move buffer to the target image
+        {
+            std::scoped_lock lock(target);
+            target.setImageData(buffer, width, height);
+        }
+        target.moveToGPU();
+
+        // Update target source name
+        target.setSourceName(std::filesystem::path(filename).filename().string());
+    }
+    catch (const std::exception& e)
+    {
+        throw std::exception(makeError(__FUNCTION__, "", e.what()).c_str());
+    }
+}
+
+uint64_t CmImageIO::cacheKey(const std::string& filename, const std::string& colorSpace, const ImageTransformParams* transformParams)
+{
+    if (S_VARS.cacheBudget < 1)
+        return 0;
+
+    std::error_code ec;
+    std::filesystem::path path = std::filesystem::canonical(filename, ec);
+    if (ec)
+        return 0;
+
+    std::filesystem::file_time_type lastWrite = std::filesystem::last_write_time(path, ec);
+    if (ec)
+        return 0;
+
+    uintmax_t fileSize = std::filesystem::file_size(path, ec);
+    if (ec)
+        return 0;
+
+    std::wstring pathString = path.wstring();
+
+    Hasher hasher;
+    hasher.add(pathString.data(), pathString.size() * sizeof(wchar_t));
+    hasher.add((int64_t)lastWrite.time_since_epoch().count()).add((uint64_t)fileSize);
+    hasher.add(colorSpace).add(S_VARS.autoDetect).add(CMS::getWorkingSpace());
+
+    // The transform decides what part of the file is decoded
+    hasher.add(transformParams != nullptr);
+    if (transformParams)
+        transformParams->cropResize.hash(hasher);
+
+    return hasher.get();
+}
+
+std::shared_ptr<CmImageIO::CacheEntry> CmImageIO::cacheFind(uint64_t key)
+{
+    if (key == 0)
+        return nullptr;
+
+    std::scoped_lock lock(S_CACHE_MUTEX);
+    for (auto it = S_CACHE.begin(); it != S_CACHE.end(); it++)
+    {
+        if ((*it)->key == key)
         {
-            uint32_t redIndexSource, redIndexTarget;
-            for (uint32_t y = 0; y < height; y++)
+            // Move to the front
+            std::shared_ptr<CacheEntry> entry = *it;
+            S_CACHE.erase(it);
+            S_CACHE.push_front(entry);
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+void CmImageIO::cacheInsert(std::shared_ptr<CacheEntry> entry)
+{
+    std::scoped_lock lock(S_CACHE_MUTEX);
+
+    // Another reader might have been first
+    for (auto it = S_CACHE.begin(); it != S_CACHE.end(); it++)
+    {
+        if ((*it)->key == entry->key)
+        {
+            S_CACHE.erase(it);
+            break;
+        }
+    }
+
+    S_CACHE.push_front(entry);
+    cacheTrim();
+}
+
+void CmImageIO::cacheTrim()
+{
+    uint64_t usage = 0;
+    for (const auto& entry : S_CACHE)
+        usage += entry->buffer->size() * sizeof(float);
+
+    while (!S_CACHE.empty() && (usage > S_VARS.cacheBudget))
+    {
+        usage -= S_CACHE.back()->buffer->size() * sizeof(float);
+        S_CACHE.pop_back();
+    }
+}
+
+// Fills in the channels that weren't read, the pixels are already 4
+// elements apart
+static void expandToRGBA(float* buffer, uint32_t width, uint32_t height, uint32_t channels)
+{
+    if (channels >= 4)
+        return;
+
+#pragma omp parallel for
+    for (int y = 0; y < (int)height; y++)
+    {
+        float* row = buffer + ((size_t)y * width * 4);
+        for (uint32_t x = 0; x < width; x++)
+        {
+            float* pixel = row + (x * 4);
+            if (channels == 1)
             {
-                for (uint32_t x = 0; x < width; x++)
+                pixel[1] = pixel[0];
+                pixel[2] = pixel[0];
+            }
+            pixel[3] = 1.0f;
+        }
+    }
+}
+
+CmImageIO::ReadRegion CmImageIO::planRead(OIIO::ImageInput& input, ImageTransformParams& transformParams)
+{
+    const uint32_t fullWidth = input.spec().width;
+    const uint32_t fullHeight = input.spec().height;
+
+    // Area kept by the crop and the size it's resized to
+    uint32_t croppedWidth, croppedHeight, resizedWidth, resizedHeight;
+    uint32_t cropStartX, cropStartY;
+    float cropX, cropY, resizeX, resizeY;
+    ImageTransform::getOutputDimensions(
+        transformParams,
+        fullWidth,
+        fullHeight,
+        croppedWidth,
+        croppedHeight,
+        cropX,
+        cropY,
+        resizedWidth,
+        resizedHeight,
+        resizeX,
+        resizeY);
+    ImageTransform::getCropStart(
+        transformParams, fullWidth, fullHeight, croppedWidth, croppedHeight, cropStartX, cropStartY);
+
+    // Smallest MIP level where the area is still at least the resized size
+    ReadRegion region;
+    uint32_t levelWidth = fullWidth;
+    uint32_t levelHeight = fullHeight;
+    while (input.seek_subimage(0, region.level + 1))
+    {
+        uint32_t nextWidth = input.spec().width;
+        uint32_t nextHeight = input.spec().height;
+        if ((((uint64_t)croppedWidth * nextWidth) / fullWidth < resizedWidth)
+            || (((uint64_t)croppedHeight * nextHeight) / fullHeight < resizedHeight))
+        {
+            break;
+        }
+
+        region.level++;
+        levelWidth = nextWidth;
+        levelHeight = nextHeight;
+    }
+    if (!input.seek_subimage(0, region.level))
+        throw std::exception(makeIoError("Couldn't seek to the MIP level", input.has_error(), input.geterror()).c_str());
+
+    // The area in the level
+    region.x = (uint32_t)(((uint64_t)cropStartX * levelWidth) / fullWidth);
+    region.y = (uint32_t)(((uint64_t)cropStartY * levelHeight) / fullHeight);
+    region.width = (uint32_t)((((uint64_t)croppedWidth * levelWidth) + (fullWidth / 2)) / fullWidth);
+    region.height = (uint32_t)((((uint64_t)croppedHeight * levelHeight) + (fullHeight / 2)) / fullHeight);
+    region.width = std::clamp(region.width, 1u, levelWidth - region.x);
+    region.height = std::clamp(region.height, 1u, levelHeight - region.y);
+
+    // Whole factors to get close to the resized size, the remainder is
+    // split between the two sides
+    region.factorX = std::max(region.width / std::max(resizedWidth, 1u), 1u);
+    region.factorY = std::max(region.height / std::max(resizedHeight, 1u), 1u);
+
+    uint32_t remainderX = region.width % region.factorX;
+    uint32_t remainderY = region.height % region.factorY;
+    region.x += remainderX / 2;
+    region.y += remainderY / 2;
+    region.width -= remainderX;
+    region.height -= remainderY;
+
+    // Nothing to save
+    if ((region.width == fullWidth) && (region.height == fullHeight)
+        && (region.factorX == 1) && (region.factorY == 1))
+    {
+        return region;
+    }
+
+    // The crop is already done, and the resize starts from the reduced size
+    uint32_t reducedWidth = region.width / region.factorX;
+    uint32_t reducedHeight = region.height / region.factorY;
+
+    transformParams.cropResize.crop = { 1.0f, 1.0f };
+    transformParams.cropResize.resize = {
+        (reducedWidth == resizedWidth) ? 1.0f : (((float)resizedWidth + 0.5f) / (float)reducedWidth),
+        (reducedHeight == resizedHeight) ? 1.0f : (((float)resizedHeight + 0.5f) / (float)reducedHeight)
+    };
+
+    return region;
+}
+
+// Box filter over factorX x factorY blocks, the first block starts at
+// (offsetX, offsetY) in the source
+static void reduceBox(
+    const float* source,
+    uint32_t sourceWidth,
+    uint32_t offsetX,
+    uint32_t offsetY,
+    uint32_t factorX,
+    uint32_t factorY,
+    float* target,
+    uint32_t targetWidth,
+    uint32_t targetHeight)
+{
+    const float weight = 1.0f / (float)(factorX * factorY);
+
+#pragma omp parallel for
+    for (int y = 0; y < (int)targetHeight; y++)
+    {
+        float* targetRow = target + ((size_t)y * targetWidth * 4);
+        for (uint32_t x = 0; x < targetWidth; x++)
+        {
+            float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            for (uint32_t by = 0; by < factorY; by++)
+            {
+                const float* sourceRow = source
+                    + ((((size_t)offsetY + ((size_t)y * factorY) + by) * sourceWidth) + offsetX + ((size_t)x * factorX)) * 4;
+                for (uint32_t bx = 0; bx < factorX; bx++)
                 {
-                    redIndexSource = (y * width + x) * 3;
-                    redIndexTarget = (y * width + x) * 4;
-                    bufferRGBA[redIndexTarget + 0] = buffer[redIndexSource + 0];
-                    bufferRGBA[redIndexTarget + 1] = buffer[redIndexSource + 1];
-                    bufferRGBA[redIndexTarget + 2] = buffer[redIndexSource + 2];
-                    bufferRGBA[redIndexTarget + 3] = 1.0f;
+                    sum[0] += sourceRow[(bx * 4) + 0];
+                    sum[1] += sourceRow[(bx * 4) + 1];
+                    sum[2] += sourceRow[(bx * 4) + 2];
+                    sum[3] += sourceRow[(bx * 4) + 3];
                 }
             }
+            for (uint32_t c = 0; c < 4; c++)
+                targetRow[(x * 4) + c] = sum[c] * weight;
         }
-        else if (channels == 1)
+    }
+}
+
+void CmImageIO::readPixels(
+    OIIO::ImageInput& input,
+    const ReadRegion& region,
+    OCIO::ConstCPUProcessorRcPtr processor,
+    const std::string& filename,
+    std::vector<float>& outBuffer)
+{
+    const OIIO::ImageSpec& spec = input.spec();
+    const uint32_t levelWidth = spec.width;
+    const uint32_t levelHeight = spec.height;
+    const uint32_t channels = spec.nchannels;
+    const bool tiled = spec.tile_width > 0;
+    const uint32_t tileWidth = std::max(spec.tile_width, 1);
+    const uint32_t tileHeight = std::max(spec.tile_height, 1);
+
+    const uint32_t width = region.width / region.factorX;
+    const uint32_t height = region.height / region.factorY;
+
+    // Whether the rows of the region are whole rows of the buffer, then
+    // they're decoded in place. Tiled files also need the region to be
+    // aligned to the tiles.
+    const bool direct = (region.factorX == 1) && (region.factorY == 1)
+        && (region.x == 0) && (region.width == levelWidth)
+        && (!tiled || ((region.y == 0) && (region.height == levelHeight)));
+
+    // Columns that are decoded, whole rows for scanline files
+    uint32_t decodeX1 = 0;
+    uint32_t decodeX2 = levelWidth;
+    if (tiled && !direct)
+    {
+        decodeX1 = (region.x / tileWidth) * tileWidth;
+        decodeX2 = std::min(((region.x + region.width + tileWidth - 1) / tileWidth) * tileWidth, levelWidth);
+    }
+    const uint32_t decodeWidth = decodeX2 - decodeX1;
+
+    // Rows of the buffer per band, whole rows of tiles when decoding in place
+    const uint32_t bandPixels = std::max(READ_BAND_PIXELS, CMS::getParallelApplyPixels());
+    uint32_t bandRows = std::max(bandPixels / std::max(decodeWidth * region.factorY, 1u), 1u);
+    if (tiled && direct)
+        bandRows = ((bandRows + tileHeight - 1) / tileHeight) * tileHeight;
+
+    outBuffer.resize((size_t)width * height * 4);
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    uint32_t decodedRows = 0;
+    bool failed = false;
+    std::string error;
+
+    // Stopped and joined by the destructor if this thread throws
+    std::jthread decoder([&](std::stop_token stopToken)
         {
-            float v;
-            uint32_t redIndexSource, redIndexTarget;
-            for (uint32_t y = 0; y < height; y++)
+            const OIIO::stride_t xStride = 4 * sizeof(float);
+            std::vector<float> decodeBuffer;
+
+            for (uint32_t y = 0; y < height; y += bandRows)
             {
-                for (uint32_t x = 0; x < width; x++)
+                if (stopToken.stop_requested())
+                    return;
+
+                uint32_t yEnd = std::min(y + bandRows, height);
+
+                // Rows of the level that are needed, tiled files are read in
+                // whole rows of tiles
+                uint32_t decodeY1 = region.y + (y * region.factorY);
+                uint32_t decodeY2 = region.y + (yEnd * region.factorY);
+                if (tiled)
                 {
-                    redIndexSource = y * width + x;
-                    redIndexTarget = (y * width + x) * 4;
-
-                    v = buffer[redIndexSource];
-                    bufferRGBA[redIndexTarget + 0] = v;
-                    bufferRGBA[redIndexTarget + 1] = v;
-                    bufferRGBA[redIndexTarget + 2] = v;
-                    bufferRGBA[redIndexTarget + 3] = 1.0f;
+                    decodeY1 = (decodeY1 / tileHeight) * tileHeight;
+                    decodeY2 = std::min(((decodeY2 + tileHeight - 1) / tileHeight) * tileHeight, levelHeight);
                 }
+
+                float* band;
+                if (direct)
+                {
+                    band = outBuffer.data() + ((size_t)y * width * 4);
+                }
+                else
+                {
+                    decodeBuffer.resize((size_t)decodeWidth * (decodeY2 - decodeY1) * 4);
+                    band = decodeBuffer.data();
+                }
+
+                const OIIO::stride_t yStride = (OIIO::stride_t)decodeWidth * xStride;
+                bool success;
+                if (tiled)
+                {
+                    success = input.read_tiles(
+                        0, region.level,
+                        spec.x + decodeX1, spec.x + decodeX2,
+                        spec.y + decodeY1, spec.y + decodeY2,
+                        spec.z, spec.z + std::max(spec.depth, 1),
+                        0, channels,
+                        OIIO::TypeDesc::FLOAT, band, xStride, yStride);
+                }
+                else
+                {
+                    success = input.read_scanlines(
+                        0, region.level,
+                        spec.y + decodeY1, spec.y + decodeY2,
+                        spec.z,
+                        0, channels,
+                        OIIO::TypeDesc::FLOAT, band, xStride, yStride);
+                }
+
+                // Cut out and reduce
+                if (success && !direct)
+                {
+                    reduceBox(
+                        decodeBuffer.data(),
+                        decodeWidth,
+                        region.x - decodeX1,
+                        (region.y + (y * region.factorY)) - decodeY1,
+                        region.factorX,
+                        region.factorY,
+                        outBuffer.data() + ((size_t)y * width * 4),
+                        width,
+                        yEnd - y);
+                }
+
+                std::scoped_lock lock(mutex);
+                if (success)
+                {
+                    decodedRows = yEnd;
+                }
+                else
+                {
+                    failed = true;
+                    error = makeIoError(
+                        strFormat("Couldn't read image from file \"%s\"", filename.c_str()),
+                        input.has_error(),
+                        input.geterror());
+                }
+                cv.notify_all();
+
+                if (!success)
+                    return;
             }
+        });
+
+    // Convert the bands as they come in
+    uint32_t convertedRows = 0;
+    while (convertedRows < height)
+    {
+        uint32_t readyRows;
+        {
+            std::unique_lock lock(mutex);
+            cv.wait(lock, [&]() { return failed || (decodedRows > convertedRows); });
+            if (failed)
+                throw std::exception(error.c_str());
+            readyRows = decodedRows;
         }
 
-        // Color Space Conversion
-        if (channels > 1)
+        float* band = outBuffer.data() + ((size_t)convertedRows * width * 4);
+        uint32_t bandHeight = readyRows - convertedRows;
+
+        expandToRGBA(band, width, bandHeight, channels);
+        if (processor)
+            CMS::applyCpuProcessor(processor, band, width, bandHeight);
+
+        convertedRows = readyRows;
+    }
+}
+
+template <typename T>
+static T readNativeScalar(const uint8_t* data, uint64_t offset)
+{
+    T v;
+    std::memcpy(&v, data + offset, sizeof(T));
+    return v;
+}
+
+void CmImageIO::readNative(CmImage& target, const std::string& filename)
+{
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>(filename);
+    const uint8_t* data = file->getData();
+    const uint64_t fileSize = file->getSize();
+
+    // Header
+    if ((fileSize < NATIVE_HEADER_SIZE)
+        || (readNativeScalar<uint32_t>(data, 0) != NATIVE_MAGIC)
+        || (readNativeScalar<uint32_t>(data, 4) != NATIVE_VERSION))
+    {
+        throw std::exception(strFormat("\"%s\" isn't a supported RealBloom image.", filename.c_str()).c_str());
+    }
+
+    uint32_t width = readNativeScalar<uint32_t>(data, 8);
+    uint32_t height = readNativeScalar<uint32_t>(data, 12);
+    uint32_t formatIndex = readNativeScalar<uint32_t>(data, 16);
+    uint32_t colorSpaceLength = readNativeScalar<uint32_t>(data, 20);
+    uint64_t contentHash = readNativeScalar<uint64_t>(data, 24);
+    uint64_t dataOffset = readNativeScalar<uint64_t>(data, 32);
+    uint64_t dataSize = readNativeScalar<uint64_t>(data, 40);
+
+    if ((width < 1) || (height < 1) || (formatIndex >= CmPixelFormat_EnumSize)
+        || (NATIVE_HEADER_SIZE + colorSpaceLength > dataOffset)
+        || ((dataOffset % NATIVE_ALIGNMENT) != 0)
+        || (dataSize != (uint64_t)width * height * getBytesPerPixel((CmPixelFormat)formatIndex))
+        || (dataOffset + dataSize > fileSize))
+    {
+        throw std::exception(strFormat("\"%s\" is damaged.", filename.c_str()).c_str());
+    }
+
+    CmPixelFormat format = (CmPixelFormat)formatIndex;
+    std::string colorSpace(reinterpret_cast<const char*>(data + NATIVE_HEADER_SIZE), colorSpaceLength);
+
+    // The file stays mapped as long as the pixels are used
+    std::shared_ptr<const CmPixelBuffer> packed = CmPixelBuffer::wrap(file, data + dataOffset, format, width, height);
+
+    if (colorSpace == CMS::getWorkingSpace())
+    {
+        std::scoped_lock lock(target);
+        target.setPackedData(packed, contentHash);
+    }
+    else
+    {
+        // Written with another working space
+        std::string csName = CMS::resolveColorSpace(colorSpace, false);
+        if (csName.empty())
+            throw std::exception(strFormat("The color space \"%s\" wasn't found.", colorSpace.c_str()).c_str());
+
+        std::shared_ptr<FloatBuffer> buffer = std::make_shared<FloatBuffer>((size_t)width * height * 4);
+        std::vector<float>& bufferData = buffer->getVector();
+        packed->unpack(bufferData.data());
+
+        try
         {
             CMS::ensureOK();
-            OCIO::ConstConfigRcPtr config = CMS::getConfig();
+            OCIO::ConstCPUProcessorRcPtr cpuProc = CMS::getCpuProcessor(CMS::getConfig(), csName, OCIO::ROLE_SCENE_LINEAR);
+            CMS::applyCpuProcessor(cpuProc, bufferData.data(), width, height);
+        }
+        catch (OCIO::Exception& e)
+        {
+            throw std::exception(strFormat("OpenColorIO Error: %s", e.what()).c_str());
+        }
+
+        std::scoped_lock lock(target);
+        target.setImageData(buffer, width, height);
+    }
+    target.moveToGPU();
+
+    target.setSourceName(std::filesystem::path(filename).filename().string());
+}
+
+void CmImageIO::writeNative(CmImage& source, const std::string& filename)
+{
+    // Share the content without copying
+    uint32_t width, height;
+    CmPixelFormat format;
+    uint64_t contentHash;
+    std::shared_ptr<const CmPixelBuffer> packed;
+    CmSharedBuffer buffer;
+    {
+        std::shared_lock lock(source);
+        width = source.getWidth();
+        height = source.getHeight();
+        format = source.getStorageFormat();
+
+        packed = source.sharePackedData();
+        if (!packed || (packed->getFormat() != format))
+        {
+            packed = nullptr;
+            if (format == CmPixelFormat::RGBA32F)
+                buffer = source.shareImageData();
+            else
+                packed = CmPixelBuffer::pack(source.getConstImageData(), width, height, format);
+        }
+
+        // Unpacked as is, the hash is probably known already
+        if (format == CmPixelFormat::RGBA32F)
+            contentHash = source.getContentHash();
+    }
+
+    const void* data = packed ? packed->getData() : buffer->data();
+    const uint64_t dataSize = (uint64_t)width * height * getBytesPerPixel(format);
+
+    // The hash of what's read back, packing can round the pixels or drop
+    // the alpha channel
+    if (format != CmPixelFormat::RGBA32F)
+        contentHash = CmImage::hashContent(data, format, width, height);
+
+    const std::string& colorSpace = CMS::getWorkingSpace();
+    const uint64_t headerEnd = NATIVE_HEADER_SIZE + colorSpace.size();
+    const uint64_t dataOffset = ((headerEnd + NATIVE_ALIGNMENT - 1) / NATIVE_ALIGNMENT) * NATIVE_ALIGNMENT;
+
+    // Written under a temporary name first, so a failed write doesn't leave
+    // a broken file behind
+    std::string tempFilename = filename + strFormat(".%016llx.tmp", Random::nextU64());
+    try
+    {
+        std::filesystem::path parentPath = std::filesystem::path(filename).parent_path();
+        if (!parentPath.empty())
+            std::filesystem::create_directories(parentPath);
+
+        {
+            std::ofstream stream(tempFilename, std::ios::binary | std::ios::trunc);
+            stmCheck(stream, __FUNCTION__, "Open");
+
+            stmWriteScalar(stream, NATIVE_MAGIC);
+            stmWriteScalar(stream, NATIVE_VERSION);
+            stmWriteScalar(stream, width);
+            stmWriteScalar(stream, height);
+            stmWriteScalar(stream, (uint32_t)format);
+            stmWriteScalar(stream, (uint32_t)colorSpace.size());
+            stmWriteScalar(stream, contentHash);
+            stmWriteScalar(stream, dataOffset);
+            stmWriteScalar(stream, dataSize);
+            stream.write(colorSpace.data(), colorSpace.size());
+
+            std::vector<char> padding(dataOffset - headerEnd, 0);
+            stream.write(padding.data(), padding.size());
+
+            stream.write(static_cast<const char*>(data), dataSize);
+            stmCheck(stream, __FUNCTION__, "Pixels");
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(tempFilename, filename, ec);
+        if (ec)
+        {
+            if (!std::filesystem::exists(filename))
+                throw std::filesystem::filesystem_error("rename", tempFilename, filename, ec);
 
+            // The old file can't be replaced while an image maps it, but it
+            // can be renamed. Images using it keep the old content.
+            std::string oldFilename = filename + strFormat(".%016llx.old", Random::nextU64());
+            std::filesystem::rename(filename, oldFilename);
             try
             {
-                OCIO::PackedImageDesc img(
-                    bufferRGBA.data(),
-                    width,
-                    height,
-                    OCIO::ChannelOrdering::CHANNEL_ORDERING_RGBA,
-                    OCIO::BitDepth::BIT_DEPTH_F32,
-                    4,                 // 4 bytes to go to the next color channel
-                    4 * 4,             // 4 color channels * 4 bytes per channel
-                    width * 4 * 4);     // width * 4 channels * 4 bytes
-
-                OCIO::ColorSpaceTransformRcPtr transform = OCIO::ColorSpaceTransform::Create();
-                transform->setSrc(csName.c_str());
-                transform->setDst(OCIO::ROLE_SCENE_LINEAR);
-
-                OCIO::ConstProcessorRcPtr proc = config->getProcessor(transform);
-                OCIO::ConstCPUProcessorRcPtr cpuProc = proc->getDefaultCPUProcessor();
-                cpuProc->apply(img);
+                std::filesystem::rename(tempFilename, filename);
             }
-            catch (OCIO::Exception& e)
+            catch (const std::exception&)
             {
-                throw std::exception(strFormat("OpenColorIO Error: %s", e.what()).c_str());
+                std::filesystem::rename(oldFilename, filename, ec);
+                throw;
             }
-        }
 
-        // Move buffer to the target image
-        {
-            std::scoped_lock lock(target);
-            target.resize(width, height, false);
-            float* targetBuffer = target.getImageData();
-            std::copy(bufferRGBA.data(), bufferRGBA.data() + bufferRGBA.size(), targetBuffer);
+            std::filesystem::remove(oldFilename, ec);
+            if (ec)
+            {
+                printWarning(__FUNCTION__, "", strFormat(
+                    "\"%s\" was in use, the old content was kept as \"%s\".",
+                    filename.c_str(), oldFilename.c_str()));
+            }
         }
-        target.moveToGPU();
-
-        // Update target source name
-        target.setSourceName(std::filesystem::path(filename).filename().string());
     }
-    catch (const std::exception& e)
+    catch (const std::exception&)
     {
-        throw std::exception(makeError(__FUNCTION__, "", e.what()).c_str());
+        std::error_code ec;
+        std::filesystem::remove(tempFilename, ec);
+        throw;
     }
 }
 
 void CmImageIO::writeImage(CmImage& source, const std::string& filename)
 {
+    ensureInit();
     try
     {
         if (filename.empty())
@@ -301,13 +988,20 @@ void CmImageIO::writeImage(CmImage& source, const std::string& filename)
         if (!contains(getAllExtensions(), extension))
             throw std::exception(strFormat("File extension \"%s\" isn't supported.", extension.c_str()).c_str());
 
+        if (contains(getNativeExtensions(), extension))
+        {
+            writeNative(source, filename);
+            source.setSourceName(std::filesystem::path(filename).filename().string());
+            return;
+        }
+
         bool nonLinear = contains(getNonLinearExtensions(), extension);
 
         // Grab the image buffer
-        source.lock();
+        source.lock_shared();
         uint32_t width = source.getWidth();
         uint32_t height = source.getHeight();
-        float* sourceBuffer = source.getImageData();
+        const float* sourceBuffer = source.getConstImageData();
         uint32_t sourceBufferSize = source.getImageDataSize();
 
         // Copy the buffer
@@ -316,7 +1010,7 @@ void CmImageIO::writeImage(CmImage& source, const std::string& filename)
         std::copy(sourceBuffer, sourceBuffer + sourceBufferSize, buffer.data());
 
         // Release the image
-        source.unlock();
+        source.unlock_shared();
 
         // Get the OCIO config
         CMS::ensureOK();
@@ -350,23 +1044,8 @@ void CmImageIO::writeImage(CmImage& source, const std::string& filename)
             // Color space conversion
             try
             {
-                OCIO::PackedImageDesc img(
-                    buffer.data(),
-                    width,
-                    height,
-                    OCIO::ChannelOrdering::CHANNEL_ORDERING_RGBA,
-                    OCIO::BitDepth::BIT_DEPTH_F32,
-                    4,                 // 4 bytes to go to the next color channel
-                    4 * 4,             // 4 color channels * 4 bytes per channel
-                    width * 4 * 4);     // width * 4 channels * 4 bytes
-
-                OCIO::ColorSpaceTransformRcPtr transform = OCIO::ColorSpaceTransform::Create();
-                transform->setSrc(OCIO::ROLE_SCENE_LINEAR);
-                transform->setDst(csName.c_str());
-
-                OCIO::ConstProcessorRcPtr proc = config->getProcessor(transform);
-                OCIO::ConstCPUProcessorRcPtr cpuProc = proc->getDefaultCPUProcessor();
-                cpuProc->apply(img);
+                OCIO::ConstCPUProcessorRcPtr cpuProc = CMS::getCpuProcessor(config, OCIO::ROLE_SCENE_LINEAR, csName);
+                CMS::applyCpuProcessor(cpuProc, buffer.data(), width, height);
             }
             catch (OCIO::Exception& e)
             {
@@ -384,8 +1063,14 @@ void CmImageIO::writeImage(CmImage& source, const std::string& filename)
             throw std::exception("Couldn't create ImageOutput.");
         }
 
-        // Create ImageSpec
-        OIIO::ImageSpec spec(width, height, 4, OIIO::TypeDesc::FLOAT);
+        // Create ImageSpec, OIIO converts to the output format while writing
+        bool exr = extension == ".exr";
+        uint32_t outChannels = S_VARS.rgbOnly ? 3 : 4;
+        OIIO::TypeDesc outFormat = (exr && S_VARS.exrHalf) ? OIIO::TypeDesc::HALF : OIIO::TypeDesc::FLOAT;
+        OIIO::ImageSpec spec(width, height, outChannels, outFormat);
+
+        if (exr)
+            spec.attribute("compression", exrCompressionAttribs[(uint32_t)S_VARS.exrCompression]);
 
         // Embed the color space name
         if ((!viewTransform) && contains(getMetaExtensions(), extension))
@@ -393,10 +1078,11 @@ void CmImageIO::writeImage(CmImage& source, const std::string& filename)
             spec.attribute(attribNameColorSpace, OIIO::TypeDesc::TypeString, csName);
         }
 
-        // Write the image
+        // Write the image, the stride skips alpha in RGB-only mode
+        out->threads((int)getMaxNumThreads());
         if (out->open(filename, spec))
         {
-            if (out->write_image(OIIO::TypeDesc::FLOAT, buffer.data()))
+            if (out->write_image(OIIO::TypeDesc::FLOAT, buffer.data(), 4 * sizeof(float)))
                 out->close();
             else
             {
@@ -458,10 +1144,20 @@ const std::vector<std::string>& CmImageIO::getAllExtensions()
         init = false;
         insertContents(exts, getLinearExtensions());
         insertContents(exts, getNonLinearExtensions());
+        insertContents(exts, getNativeExtensions());
     }
     return exts;
 }
 
+const std::vector<std::string>& CmImageIO::getNativeExtensions()
+{
+    static std::vector<std::string> exts
+    {
+        ".rbimg"
+    };
+    return exts;
+}
+
 const std::vector<std::string>& CmImageIO::getMetaExtensions()
 {
     static std::vector<std::string> exts
@@ -476,13 +1172,16 @@ const std::vector<std::string>& CmImageIO::getOpenFilterList()
     static std::vector<std::string> filterList
     {
         "All Images",
-        "exr,tif,tiff,png,jpg,jpeg,bmp",
+        "exr,tif,tiff,png,jpg,jpeg,bmp,rbimg",
 
         "Linear",
         "exr,tif,tiff",
 
         "Non-Linear",
-        "png,jpg,jpeg,bmp"
+        "png,jpg,jpeg,bmp",
+
+        "RealBloom Image",
+        "rbimg"
     };
     return filterList;
 }
@@ -504,11 +1203,26 @@ const std::vector<std::string>& CmImageIO::getSaveFilterList()
         "jpg,jpeg",
 
         "Bitmap",
-        "bmp"
+        "bmp",
+
+        "RealBloom Image",
+        "rbimg"
     };
     return filterList;
 }
 
+const std::vector<std::string>& CmImageIO::getExrCompressionNames()
+{
+    static std::vector<std::string> names
+    {
+        "None",
+        "ZIP",
+        "PIZ",
+        "DWAA"
+    };
+    return names;
+}
+
 std::string CmImageIO::getDefaultFilename()
 {
     return "untitled";
@@ -1,9 +1,13 @@
 #pragma once
 
 #include <iostream>
+#include <fstream>
 #include <string>
 #include <vector>
+#include <list>
 #include <mutex>
+#include <condition_variable>
+#include <thread>
 #include <memory>
 #include <filesystem>
 
@@ -18,8 +22,25 @@ namespace OCIO = OpenColorIO_v2_1;
 #include "../Utils/OpenGL/GlTexture.h"
 #include "../Utils/OpenGL/GlFrameBuffer.h"
 #include "../Utils/OpenGL/GlUtils.h"
+#include "../Utils/ImageTransform.h"
+#include "../Utils/LazyInit.h"
+#include "../Utils/Hash.h"
+#include "../Utils/MappedFile.h"
 #include "../Utils/Misc.h"
 
+// Compression for OpenEXR output
+enum class ExrCompression
+{
+    None,
+    Zip,
+    Piz,
+    Dwaa
+};
+constexpr uint32_t ExrCompression_EnumSize = 4;
+
+// Default memory budget for decoded images kept by readImage(), in bytes
+constexpr uint64_t CMIMAGEIO_DEF_CACHE_BUDGET = 1024ull * 1024ull * 1024ull;
+
 // Color-Managed Image IO (Global)
 class CmImageIO
 {
@@ -28,6 +49,7 @@ public:
     CmImageIO(const CmImageIO&) = delete;
     CmImageIO& operator= (const CmImageIO&) = delete;
 
+    // Called on first use, calling it beforehand moves the cost up front
     static void init();
     static void cleanUp();
 
@@ -36,25 +58,61 @@ public:
     static const std::string& getNonLinearSpace();
     static bool getAutoDetect();
     static bool getApplyViewTransform();
+    static bool getExrHalf();
+    static bool getRgbOnly();
+    static ExrCompression getExrCompression();
 
     static void setInputSpace(const std::string& colorSpace);
     static void setOutputSpace(const std::string& colorSpace);
     static void setNonLinearSpace(const std::string& colorSpace);
     static void setAutoDetect(bool autoDetect);
     static void setApplyViewTransform(bool applyViewTransform);
+    static void setExrHalf(bool exrHalf);
+    static void setRgbOnly(bool rgbOnly);
+    static void setExrCompression(ExrCompression exrCompression);
+
+    // transformParams: The transform that will be applied to the image.
+    // Only the area kept by the crop is decoded, at no less than the resized
+    // size. MIP levels are used when the file has them, and the rest is
+    // reduced by whole factors while decoding. The crop and the resize are
+    // updated to give the same output from the smaller image.
+    // useCache: Look for the image in the cache and keep it there, files
+    // that are only read once can skip it.
+    static void readImage(
+        CmImage& target,
+        const std::string& filename,
+        ImageTransformParams* transformParams = nullptr,
+        bool useCache = true);
 
-    static void readImage(CmImage& target, const std::string& filename);
+    // Decoded images are kept and shared with the next reads of the same
+    // file, as long as it hasn't changed and the color spaces and the
+    // transform are the same. The least recently used ones are dropped to
+    // stay within the budget (bytes), 0 turns the cache off. The cache is
+    // off by default, the CLI turns it on for its sessions.
+    static uint64_t getCacheBudget();
+    static void setCacheBudget(uint64_t budget);
+    static uint64_t getCacheUsage();
+    static uint32_t getCacheCount();
+    static void clearCache();
     static void writeImage(CmImage& source, const std::string& filename);
 
     static const std::vector<std::string>& getLinearExtensions();
     static const std::vector<std::string>& getNonLinearExtensions();
     static const std::vector<std::string>& getAllExtensions();
 
+    // RealBloom's own format for intermediate images. The pixels are stored
+    // in the image's storage format and the working space, and are used
+    // straight from the mapped file when read.
+    static const std::vector<std::string>& getNativeExtensions();
+
     // Linear extensions that support custom metadata
     static const std::vector<std::string>& getMetaExtensions();
 
     static const std::vector<std::string>& getOpenFilterList();
     static const std::vector<std::string>& getSaveFilterList();
+
+    // Display names, in the order of ExrCompression
+    static const std::vector<std::string>& getExrCompressionNames();
     static std::string getDefaultFilename();
 
 private:
@@ -65,7 +123,72 @@ private:
         std::string nonLinearSpace = "";
         bool autoDetect = true;
         bool applyViewTransform = false;
+
+        // Output format, alpha is left out in RGB-only mode
+        bool exrHalf = false;
+        bool rgbOnly = false;
+        ExrCompression exrCompression = ExrCompression::Zip;
+
+        uint64_t cacheBudget = 0;
     };
     static CmImageIoVars S_VARS;
 
+    struct CacheEntry
+    {
+        uint64_t key = 0;
+        CmSharedBuffer buffer = nullptr;
+        uint32_t width = 0;
+        uint32_t height = 0;
+
+        // What planRead() changed the crop and the resize to
+        ImageTransformParams::CropResizeParams cropResize;
+    };
+
+    // Most recently used first, readers run in parallel in batches
+    static std::list<std::shared_ptr<CacheEntry>> S_CACHE;
+    static std::mutex S_CACHE_MUTEX;
+
+    // Returns 0 if the file can't be found
+    static uint64_t cacheKey(const std::string& filename, const std::string& colorSpace, const ImageTransformParams* transformParams);
+    static std::shared_ptr<CacheEntry> cacheFind(uint64_t key);
+    static void cacheInsert(std::shared_ptr<CacheEntry> entry);
+    static void cacheTrim();
+
+    // Native format, the transform and the color settings don't apply
+    static void readNative(CmImage& target, const std::string& filename);
+    static void writeNative(CmImage& source, const std::string& filename);
+
+    static LazyInit S_INIT;
+    static void ensureInit();
+    static void initInternal();
+
+    // Area of a MIP level to decode, reduced by the factors. The size is a
+    // multiple of the factors.
+    struct ReadRegion
+    {
+        uint32_t level = 0;
+        uint32_t x = 0;
+        uint32_t y = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t factorX = 1;
+        uint32_t factorY = 1;
+    };
+
+    // Picks the region for the transform, seeks to its level, and updates
+    // the transform to match
+    static ReadRegion planRead(OIIO::ImageInput& input, ImageTransformParams& transformParams);
+
+    // Decodes bands of rows on another thread, straight into the buffer with
+    // room left for the missing channels, or through a smaller buffer when
+    // the region has to be cut out or reduced. This thread expands the bands
+    // that are ready to RGBA and converts them in place. The processor can
+    // be null.
+    static void readPixels(
+        OIIO::ImageInput& input,
+        const ReadRegion& region,
+        OCIO::ConstCPUProcessorRcPtr processor,
+        const std::string& filename,
+        std::vector<float>& outBuffer);
+
 };
@@ -0,0 +1,238 @@
+#include "CmLut3D.h"
+
+#include <xmmintrin.h>
+
+// The shaper maps log2(v + 2^SHAPER_MIN_LOG) from [SHAPER_MIN_LOG,
+// SHAPER_MAX_LOG] to [0, 1], so that 0 stays 0 and each stop gets about the
+// same number of points
+static constexpr float SHAPER_MIN_LOG = -12.0f;
+static constexpr float SHAPER_MAX_LOG = 12.0f;
+static const float SHAPER_OFFSET = exp2f(SHAPER_MIN_LOG);
+
+// Cells checked per dimension when measuring the error
+static constexpr uint32_t ERROR_CHECK_CELLS = 32;
+
+// Binary form, the version changes with the shaper or the layout
+static constexpr uint32_t FILE_MAGIC = 0x334C4252; // "RBL3"
+static constexpr uint32_t FILE_VERSION = 1;
+
+static inline float shaper(float v)
+{
+    float s = (log2f(std::max(v, 0.0f) + SHAPER_OFFSET) - SHAPER_MIN_LOG) / (SHAPER_MAX_LOG - SHAPER_MIN_LOG);
+    return std::clamp(s, 0.0f, 1.0f);
+}
+
+static inline float invShaper(float s)
+{
+    return std::max(exp2f((s * (SHAPER_MAX_LOG - SHAPER_MIN_LOG)) + SHAPER_MIN_LOG) - SHAPER_OFFSET, 0.0f);
+}
+
+CmLut3D::CmLut3D(OCIO::ConstCPUProcessorRcPtr processor, uint32_t size)
+    : m_size(std::clamp(size, CMLUT3D_MIN_SIZE, CMLUT3D_MAX_SIZE))
+{
+    if (!processor)
+        throw std::exception(makeError(__FUNCTION__, "", "Invalid processor").c_str());
+
+    const uint32_t n = m_size;
+    const size_t numPoints = (size_t)n * n * n;
+
+    // Run the processor on every point
+    std::vector<float> points(numPoints * 3);
+    for (uint32_t b = 0; b < n; b++)
+    {
+        for (uint32_t g = 0; g < n; g++)
+        {
+            for (uint32_t r = 0; r < n; r++)
+            {
+                size_t index = ((((size_t)b * n) + g) * n + r) * 3;
+                points[index + 0] = invShaper((float)r / (float)(n - 1));
+                points[index + 1] = invShaper((float)g / (float)(n - 1));
+                points[index + 2] = invShaper((float)b / (float)(n - 1));
+            }
+        }
+    }
+    CMS::applyCpuProcessor(processor, points.data(), n, n * n, 3);
+
+    m_table.resize(numPoints * 4);
+    for (size_t i = 0; i < numPoints; i++)
+    {
+        m_table[(i * 4) + 0] = points[(i * 3) + 0];
+        m_table[(i * 4) + 1] = points[(i * 3) + 1];
+        m_table[(i * 4) + 2] = points[(i * 3) + 2];
+        m_table[(i * 4) + 3] = 0.0f;
+    }
+    clearVector(points);
+
+    // Compare with the processor at the centers of the cells
+    const uint32_t numCells = n - 1;
+    const uint32_t step = std::max(numCells / ERROR_CHECK_CELLS, 1u);
+    const uint32_t numChecks = (numCells + step - 1) / step;
+
+    std::vector<float> exact((size_t)numChecks * numChecks * numChecks * 4);
+    for (uint32_t b = 0; b < numChecks; b++)
+    {
+        for (uint32_t g = 0; g < numChecks; g++)
+        {
+            for (uint32_t r = 0; r < numChecks; r++)
+            {
+                size_t index = ((((size_t)b * numChecks) + g) * numChecks + r) * 4;
+                exact[index + 0] = invShaper(((float)(r * step) + 0.5f) / (float)numCells);
+                exact[index + 1] = invShaper(((float)(g * step) + 0.5f) / (float)numCells);
+                exact[index + 2] = invShaper(((float)(b * step) + 0.5f) / (float)numCells);
+                exact[index + 3] = 1.0f;
+            }
+        }
+    }
+
+    std::vector<float> baked = exact;
+    apply(baked.data(), numChecks, numChecks * numChecks);
+    CMS::applyCpuProcessor(processor, exact.data(), numChecks, numChecks * numChecks);
+
+    for (size_t i = 0; i < exact.size(); i += 4)
+        for (size_t c = 0; c < 3; c++)
+            m_maxError = std::max(m_maxError, fabsf(baked[i + c] - exact[i + c]));
+}
+
+uint32_t CmLut3D::getSize() const
+{
+    return m_size;
+}
+
+float CmLut3D::getMaxError() const
+{
+    return m_maxError;
+}
+
+void CmLut3D::apply(float* buffer, uint32_t width, uint32_t height) const
+{
+#pragma omp parallel for
+    for (int y = 0; y < (int)height; y++)
+    {
+        float* row = buffer + ((size_t)y * width * 4);
+        for (uint32_t x = 0; x < width; x++)
+            applyPixel(row + (x * 4));
+    }
+}
+
+void CmLut3D::write(std::ostream& stream, uint64_t key) const
+{
+    stmWriteScalar(stream, FILE_MAGIC);
+    stmWriteScalar(stream, FILE_VERSION);
+    stmWriteScalar(stream, key);
+    stmWriteScalar(stream, m_size);
+    stmWriteScalar(stream, m_maxError);
+    stream.write(reinterpret_cast<const char*>(m_table.data()), m_table.size() * sizeof(float));
+    stmCheck(stream, __FUNCTION__, "table");
+}
+
+std::shared_ptr<CmLut3D> CmLut3D::read(std::istream& stream, uint64_t key)
+{
+    if ((stmReadScalar<uint32_t>(stream) != FILE_MAGIC)
+        || (stmReadScalar<uint32_t>(stream) != FILE_VERSION)
+        || (stmReadScalar<uint64_t>(stream) != key))
+    {
+        return nullptr;
+    }
+
+    uint32_t size = stmReadScalar<uint32_t>(stream);
+    float maxError = stmReadScalar<float>(stream);
+    if (stream.fail() || (size < CMLUT3D_MIN_SIZE) || (size > CMLUT3D_MAX_SIZE))
+        return nullptr;
+
+    std::shared_ptr<CmLut3D> lut(new CmLut3D());
+    lut->m_size = size;
+    lut->m_maxError = maxError;
+    lut->m_table.resize((size_t)size * size * size * 4);
+
+    stream.read(reinterpret_cast<char*>(lut->m_table.data()), lut->m_table.size() * sizeof(float));
+    if (stream.fail())
+        return nullptr;
+
+    return lut;
+}
+
+void CmLut3D::applyPixel(float* pixel) const
+{
+    const uint32_t n = m_size;
+    const float maxCoord = (float)(n - 1);
+
+    // Lattice coordinates
+    float fr = shaper(pixel[0]) * maxCoord;
+    float fg = shaper(pixel[1]) * maxCoord;
+    float fb = shaper(pixel[2]) * maxCoord;
+
+    uint32_t ir = std::min((uint32_t)fr, n - 2);
+    uint32_t ig = std::min((uint32_t)fg, n - 2);
+    uint32_t ib = std::min((uint32_t)fb, n - 2);
+
+    fr -= (float)ir;
+    fg -= (float)ig;
+    fb -= (float)ib;
+
+    // Offsets to the neighbors, in elements
+    const size_t dr = 4;
+    const size_t dg = (size_t)n * 4;
+    const size_t db = (size_t)n * n * 4;
+
+    const float* c000 = m_table.data() + (((((size_t)ib * n) + ig) * n + ir) * 4);
+    const float* c111 = c000 + dr + dg + db;
+
+    // Pick the tetrahedron that contains the point. The result is
+    // c000 + w1 * (c1 - c000) + w2 * (c2 - c1) + w3 * (c111 - c2),
+    // where c1 and c2 are the vertices along the path from c000 to c111
+    // in the order of the largest fractions.
+    const float* c1;
+    const float* c2;
+    float w1, w2, w3;
+    if (fr > fg)
+    {
+        if (fg > fb)
+        {
+            c1 = c000 + dr; c2 = c000 + dr + dg;
+            w1 = fr; w2 = fg; w3 = fb;
+        }
+        else if (fr > fb)
+        {
+            c1 = c000 + dr; c2 = c000 + dr + db;
+            w1 = fr; w2 = fb; w3 = fg;
+        }
+        else
+        {
+            c1 = c000 + db; c2 = c000 + dr + db;
+            w1 = fb; w2 = fr; w3 = fg;
+        }
+    }
+    else
+    {
+        if (fb > fg)
+        {
+            c1 = c000 + db; c2 = c000 + dg + db;
+            w1 = fb; w2 = fg; w3 = fr;
+        }
+        else if (fb > fr)
+        {
+            c1 = c000 + dg; c2 = c000 + dg + db;
+            w1 = fg; w2 = fb; w3 = fr;
+        }
+        else
+        {
+            c1 = c000 + dg; c2 = c000 + dr + dg;
+            w1 = fg; w2 = fr; w3 = fb;
+        }
+    }
+
+    __m128 v000 = _mm_load_ps(c000);
+    __m128 v1 = _mm_load_ps(c1);
+    __m128 v2 = _mm_load_ps(c2);
+    __m128 v111 = _mm_load_ps(c111);
+
+    __m128 result = v000;
+    result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(w1), _mm_sub_ps(v1, v000)));
+    result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(w2), _mm_sub_ps(v2, v1)));
+    result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(w3), _mm_sub_ps(v111, v2)));
+
+    // Keep alpha
+    float alpha = pixel[3];
+    _mm_storeu_ps(pixel, result);
+    pixel[3] = alpha;
+}
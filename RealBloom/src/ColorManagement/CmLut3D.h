@@ -0,0 +1,52 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "CMS.h"
+
+#include "../Utils/BufferPool.h"
+#include "../Utils/StreamUtils.h"
+
+// Smallest and largest sizes for a 3D LUT, in points per dimension
+constexpr uint32_t CMLUT3D_MIN_SIZE = 2;
+constexpr uint32_t CMLUT3D_MAX_SIZE = 129;
+
+// Processor baked into a log2 shaper and a 3D LUT. The shaper covers 0 to
+// 4096 in scene-linear, negative values are clamped to 0. Much cheaper to
+// apply than a processor with many ops, at the cost of a small error.
+class CmLut3D
+{
+public:
+    CmLut3D(OCIO::ConstCPUProcessorRcPtr processor, uint32_t size);
+
+    uint32_t getSize() const;
+
+    // Largest difference from the processor in any channel, measured at
+    // the centers of the cells where the interpolation error is highest
+    float getMaxError() const;
+
+    // RGBA, every 4 elements represent a pixel. Alpha is left untouched.
+    // Uses tetrahedral interpolation.
+    void apply(float* buffer, uint32_t width, uint32_t height) const;
+
+    // Binary form for caching on disk, the key is stored with the table and
+    // read() returns null if it doesn't match.
+    void write(std::ostream& stream, uint64_t key) const;
+    static std::shared_ptr<CmLut3D> read(std::istream& stream, uint64_t key);
+
+private:
+    CmLut3D() {};
+
+    uint32_t m_size = 0;
+    float m_maxError = 0.0f;
+
+    // RGB and one element of padding per point, so every point can be read
+    // with a single SIMD load. Red changes the fastest.
+    PooledVector<float> m_table;
+
+    void applyPixel(float* pixel) const;
+
+};
@@ -0,0 +1,169 @@
+#include "CmPixelBuffer.h"
+
+uint32_t getNumChannels(CmPixelFormat format)
+{
+    switch (format)
+    {
+    case CmPixelFormat::RGB32F:
+        return 3;
+    case CmPixelFormat::R32F:
+        return 1;
+    default:
+        return 4;
+    }
+}
+
+uint32_t getBytesPerPixel(CmPixelFormat format)
+{
+    if (format == CmPixelFormat::RGBA16F)
+        return getNumChannels(format) * sizeof(uint16_t);
+    return getNumChannels(format) * sizeof(float);
+}
+
+CmPixelBuffer::CmPixelBuffer(CmPixelFormat format, uint32_t width, uint32_t height)
+    : m_format(format), m_width(width), m_height(height)
+{
+    size_t numElements = (size_t)width * (size_t)height * getNumChannels(format);
+    if (format == CmPixelFormat::RGBA16F)
+        m_data16.resize(numElements);
+    else
+        m_data32.resize(numElements);
+}
+
+CmPixelFormat CmPixelBuffer::getFormat() const
+{
+    return m_format;
+}
+
+uint32_t CmPixelBuffer::getWidth() const
+{
+    return m_width;
+}
+
+uint32_t CmPixelBuffer::getHeight() const
+{
+    return m_height;
+}
+
+size_t CmPixelBuffer::getSizeInBytes() const
+{
+    if (m_external)
+        return (size_t)m_width * (size_t)m_height * getBytesPerPixel(m_format);
+    return (m_data32.size() * sizeof(float)) + (m_data16.size() * sizeof(uint16_t));
+}
+
+std::shared_ptr<CmPixelBuffer> CmPixelBuffer::pack(const float* buffer, uint32_t width, uint32_t height, CmPixelFormat format)
+{
+    std::shared_ptr<CmPixelBuffer> packed = std::make_shared<CmPixelBuffer>(format, width, height);
+    const int numPixels = (int)((size_t)width * (size_t)height);
+
+    float* data32 = packed->m_data32.data();
+    uint16_t* data16 = packed->m_data16.data();
+
+    switch (format)
+    {
+    case CmPixelFormat::RGBA32F:
+        std::copy(buffer, buffer + ((size_t)numPixels * 4), data32);
+        break;
+    case CmPixelFormat::RGB32F:
+#pragma omp parallel for
+        for (int i = 0; i < numPixels; i++)
+        {
+            data32[i * 3 + 0] = buffer[i * 4 + 0];
+            data32[i * 3 + 1] = buffer[i * 4 + 1];
+            data32[i * 3 + 2] = buffer[i * 4 + 2];
+        }
+        break;
+    case CmPixelFormat::R32F:
+#pragma omp parallel for
+        for (int i = 0; i < numPixels; i++)
+            data32[i] = buffer[i * 4];
+        break;
+    case CmPixelFormat::RGBA16F:
+#pragma omp parallel for
+        for (int i = 0; i < numPixels * 4; i++)
+            data16[i] = floatToHalf(buffer[i]);
+        break;
+    default:
+        break;
+    }
+
+    return packed;
+}
+
+void CmPixelBuffer::unpack(float* outBuffer) const
+{
+    unpackRows(0, m_height, outBuffer);
+}
+
+void CmPixelBuffer::unpackRows(uint32_t y, uint32_t numRows, float* outBuffer) const
+{
+    const int numPixels = (int)((size_t)m_width * (size_t)numRows);
+    const size_t firstElement = (size_t)y * (size_t)m_width * getNumChannels(m_format);
+
+    const float* data32 = nullptr;
+    const uint16_t* data16 = nullptr;
+    if (m_format == CmPixelFormat::RGBA16F)
+        data16 = (m_external ? static_cast<const uint16_t*>(m_external) : m_data16.data()) + firstElement;
+    else
+        data32 = (m_external ? static_cast<const float*>(m_external) : m_data32.data()) + firstElement;
+
+    switch (m_format)
+    {
+    case CmPixelFormat::RGBA32F:
+        std::copy(data32, data32 + ((size_t)numPixels * 4), outBuffer);
+        break;
+    case CmPixelFormat::RGB32F:
+#pragma omp parallel for
+        for (int i = 0; i < numPixels; i++)
+        {
+            outBuffer[i * 4 + 0] = data32[i * 3 + 0];
+            outBuffer[i * 4 + 1] = data32[i * 3 + 1];
+            outBuffer[i * 4 + 2] = data32[i * 3 + 2];
+            outBuffer[i * 4 + 3] = 1.0f;
+        }
+        break;
+    case CmPixelFormat::R32F:
+#pragma omp parallel for
+        for (int i = 0; i < numPixels; i++)
+        {
+            outBuffer[i * 4 + 0] = data32[i];
+            outBuffer[i * 4 + 1] = data32[i];
+            outBuffer[i * 4 + 2] = data32[i];
+            outBuffer[i * 4 + 3] = 1.0f;
+        }
+        break;
+    case CmPixelFormat::RGBA16F:
+#pragma omp parallel for
+        for (int i = 0; i < numPixels * 4; i++)
+            outBuffer[i] = halfToFloat(data16[i]);
+        break;
+    default:
+        break;
+    }
+}
+
+std::shared_ptr<CmPixelBuffer> CmPixelBuffer::wrap(
+    std::shared_ptr<const void> owner,
+    const void* data,
+    CmPixelFormat format,
+    uint32_t width,
+    uint32_t height)
+{
+    std::shared_ptr<CmPixelBuffer> wrapped(new CmPixelBuffer());
+    wrapped->m_format = format;
+    wrapped->m_width = width;
+    wrapped->m_height = height;
+    wrapped->m_owner = owner;
+    wrapped->m_external = data;
+    return wrapped;
+}
+
+const void* CmPixelBuffer::getData() const
+{
+    if (m_external)
+        return m_external;
+    if (m_format == CmPixelFormat::RGBA16F)
+        return m_data16.data();
+    return m_data32.data();
+}
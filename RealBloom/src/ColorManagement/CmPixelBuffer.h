@@ -0,0 +1,76 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "../Utils/NumberHelpers.h"
+
+// Storage formats for images at rest. Pixels are always converted to
+// RGBA32F before being processed.
+enum class CmPixelFormat
+{
+    // Full precision
+    RGBA32F,
+
+    // Alpha is 1
+    RGB32F,
+
+    // Grayscale, unpacked as (v, v, v, 1)
+    R32F,
+
+    // Half precision
+    RGBA16F
+};
+constexpr uint32_t CmPixelFormat_EnumSize = 4;
+
+uint32_t getNumChannels(CmPixelFormat format);
+uint32_t getBytesPerPixel(CmPixelFormat format);
+
+// Pixels packed in one of the storage formats
+class CmPixelBuffer
+{
+public:
+    CmPixelBuffer(CmPixelFormat format, uint32_t width, uint32_t height);
+
+    CmPixelFormat getFormat() const;
+    uint32_t getWidth() const;
+    uint32_t getHeight() const;
+    size_t getSizeInBytes() const;
+
+    // Conversion from and to RGBA32F, every 4 elements represent a pixel.
+    // Channels that the format doesn't have are dropped.
+    static std::shared_ptr<CmPixelBuffer> pack(const float* buffer, uint32_t width, uint32_t height, CmPixelFormat format);
+    void unpack(float* outBuffer) const;
+
+    // Unpacks numRows rows starting from y
+    void unpackRows(uint32_t y, uint32_t numRows, float* outBuffer) const;
+
+    // Packed pixels in memory owned by something else, like a mapped file,
+    // which is kept alive as long as the buffer. Nothing is copied.
+    static std::shared_ptr<CmPixelBuffer> wrap(
+        std::shared_ptr<const void> owner,
+        const void* data,
+        CmPixelFormat format,
+        uint32_t width,
+        uint32_t height);
+
+    // The packed pixels, getSizeInBytes() long
+    const void* getData() const;
+
+private:
+    CmPixelBuffer() {};
+
+    CmPixelFormat m_format = CmPixelFormat::RGBA32F;
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+
+    // 32-bit formats use data32, half-precision formats use data16
+    std::vector<float> m_data32;
+    std::vector<uint16_t> m_data16;
+
+    // Used instead of the vectors when wrapping
+    std::shared_ptr<const void> m_owner = nullptr;
+    const void* m_external = nullptr;
+
+};
@@ -2,8 +2,20 @@
 
 XyzConversionInfo CmXYZ::S_INFO;
 BaseStatus CmXYZ::S_STATUS;
+LazyInit CmXYZ::S_INIT("XYZ Utility");
+
+void CmXYZ::ensureInit()
+{
+    S_INIT.ensure(initInternal);
+}
 
 bool CmXYZ::init()
+{
+    ensureInit();
+    return S_STATUS.isOK();
+}
+
+void CmXYZ::initInternal()
 {
     try
     {
@@ -63,28 +75,30 @@ bool CmXYZ::init()
     {
         S_STATUS.setError(makeError(__FUNCTION__, "", e.what(), true));
     }
-
-    return S_STATUS.isOK();
 }
 
 XyzConversionInfo CmXYZ::getConversionInfo()
 {
+    ensureInit();
     return S_INFO;
 }
 
 void CmXYZ::setConversionInfo(const XyzConversionInfo& conversionInfo)
 {
+    ensureInit();
     S_STATUS.reset();
     S_INFO = conversionInfo;
 }
 
 const BaseStatus& CmXYZ::getStatus()
 {
+    ensureInit();
     return S_STATUS;
 }
 
 void CmXYZ::ensureOK()
 {
+    ensureInit();
     if (!S_STATUS.isOK())
         throw std::exception(strFormat("CmXYZ failure: %s", S_STATUS.getError().c_str()).c_str());
 }
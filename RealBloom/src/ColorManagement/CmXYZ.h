@@ -11,6 +11,7 @@ namespace OCIO = OpenColorIO_v2_1;
 #include "CMS.h"
 
 #include "../Utils/Status.h"
+#include "../Utils/LazyInit.h"
 #include "../Utils/Misc.h"
 
 enum class XyzConversionMethod
@@ -44,6 +45,7 @@ public:
     CmXYZ(const CmXYZ&) = delete;
     CmXYZ& operator= (const CmXYZ&) = delete;
 
+    // Called on first use, calling it beforehand moves the cost up front
     static bool init();
 
     static XyzConversionInfo getConversionInfo();
@@ -56,4 +58,8 @@ private:
     static XyzConversionInfo S_INFO;
     static BaseStatus S_STATUS;
 
+    static LazyInit S_INIT;
+    static void ensureInit();
+    static void initInternal();
+
 };
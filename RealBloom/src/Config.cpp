@@ -18,6 +18,7 @@ const char* Config::DOCS_URL = "https://github.com/bean-mhm/realbloom/blob/main/
 
 // Variable
 float Config::UI_SCALE = 1.0f;
+uint32_t Config::VIEW_LUT_SIZE = 0;
 
 void Config::load()
 {
@@ -55,6 +56,17 @@ void Config::load()
                 UI_SCALE = fminf(fmaxf(Config::UI_SCALE, Config::UI_MIN_SCALE), Config::UI_MAX_SCALE);
             }
         }
+
+        // Color Management
+        {
+            pugi::xml_node cmNode = root.child("ColorManagement");
+
+            // View LUT Size
+            stage = "ColorManagement/ViewLutSize";
+            std::string lutSizeValue = cmNode.child("ViewLutSize").text().as_string();
+            if (!lutSizeValue.empty())
+                VIEW_LUT_SIZE = (uint32_t)std::max(std::stoi(lutSizeValue), 0);
+        }
     }
     catch (const std::exception& e)
     {
@@ -88,6 +100,15 @@ void Config::save()
             scaleNode.append_child(pugi::node_pcdata).set_value(strFormat("%f", UI_SCALE).c_str());
         }
 
+        // Color Management
+        {
+            pugi::xml_node cmNode = root.append_child("ColorManagement");
+
+            // View LUT Size
+            pugi::xml_node lutSizeNode = cmNode.append_child("ViewLutSize");
+            lutSizeNode.append_child(pugi::node_pcdata).set_value(strFormat("%u", VIEW_LUT_SIZE).c_str());
+        }
+
         // Write to the file
         stage = "Write";
         doc.save(outFile, "  ");
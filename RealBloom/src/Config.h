@@ -32,6 +32,9 @@ public:
     // Variable
     static float UI_SCALE;
 
+    // Size of the baked view transform LUT, 0 means off
+    static uint32_t VIEW_LUT_SIZE;
+
     static void load();
     static void save();
 
@@ -98,15 +98,23 @@ int main(int argc, char** argv)
         new NumPunctFacet
     ));
 
+    std::chrono::system_clock::time_point phaseStartTime = std::chrono::system_clock::now();
+
     // Load config
     Config::load();
+    CMS::setViewLutSize(Config::VIEW_LUT_SIZE);
+    StartupTimes::add("Config", getElapsedMs(phaseStartTime));
 
     // CLI
+    phaseStartTime = std::chrono::system_clock::now();
     CLI::Interface::init(argc, argv);
+    StartupTimes::add("Command-line interface", getElapsedMs(phaseStartTime));
 
     // GUI-specific
     if (!CLI::Interface::active())
     {
+        phaseStartTime = std::chrono::system_clock::now();
+
         // Change the working directory so ImGui can load its
         // config properly
         SetCurrentDirectoryA(getExecDir().c_str());
@@ -133,20 +141,28 @@ int main(int argc, char** argv)
             std::cout << "Failed to initialize ImGui.\n";
             return 1;
         }
+
+        StartupTimes::add("Window and OpenGL", getElapsedMs(phaseStartTime));
     }
 
-    // Color Management System
-    if (!CMS::init())
-        return 1;
+    // Color management is initialized on first use in the CLI, so that
+    // commands that don't need it don't wait for it. The GUI needs all of
+    // it right away.
+    if (!CLI::Interface::active())
+    {
+        // Color Management System
+        if (!CMS::init())
+            return 1;
 
-    // Color Matching Functions
-    CMF::init();
+        // Color Matching Functions
+        CMF::init();
 
-    // XYZ Utility
-    CmXYZ::init();
+        // XYZ Utility
+        CmXYZ::init();
 
-    // Color Managed Image IO
-    CmImageIO::init();
+        // Color Managed Image IO
+        CmImageIO::init();
+    }
 
     // GUI-specific
     if (!CLI::Interface::active())
@@ -347,11 +363,11 @@ void layoutImagePanels()
     // Selected slot
     ImageSlot& selSlot = slots[selSlotIndex];
 
-    // Move to GPU when switching slots
+    // Render again when switching slots, the framebuffer is shared
     static int lastSelSlotIndex = selSlotIndex;
     if (selSlotIndex != lastSelSlotIndex)
     {
-        selSlot.viewImage->moveToGPU();
+        selSlot.viewImage->updateView();
         lastSelSlotIndex = selSlotIndex;
     }
 
@@ -530,7 +546,8 @@ void layoutImagePanels()
         if (getElapsedMs(ioErrorTime) > 5000) ioError = "";
         if (!ioError.empty()) imGuiText(ioError, true, false);
 
-        // Image
+        // Image, rendered at the display resolution when zoomed out
+        selSlot.viewImage->setDisplayScale(imageZoom);
         ImGui::Image(
             (void*)(intptr_t)(selSlot.viewImage->getGlTexture()),
             ImVec2((float)imageWidth * imageZoom, (float)imageHeight * imageZoom),
@@ -611,7 +628,7 @@ void layoutColorManagement()
         {
             cmsParamsChanged = false;
             for (auto& slot : slots)
-                slot.viewImage->moveToGPU();
+                slot.viewImage->updateView();
         }
 
     }
@@ -684,6 +701,27 @@ void layoutColorManagement()
         if (ImGui::IsItemHovered())
             ImGui::SetTooltip("Apply view transform on linear images");
 
+        // RGB Only
+        bool rgbOnly = CmImageIO::getRgbOnly();
+        if (ImGui::Checkbox("RGB Only##IIO", &rgbOnly))
+            CmImageIO::setRgbOnly(rgbOnly);
+        if (ImGui::IsItemHovered())
+            ImGui::SetTooltip("Leave out the alpha channel when saving");
+
+        // Half Float
+        bool exrHalf = CmImageIO::getExrHalf();
+        if (ImGui::Checkbox("Half Float##IIO", &exrHalf))
+            CmImageIO::setExrHalf(exrHalf);
+        if (ImGui::IsItemHovered())
+            ImGui::SetTooltip("Save OpenEXR images with 16-bit floats");
+
+        // Compression
+        int selCompression = (int)CmImageIO::getExrCompression();
+        if (imGuiCombo("Compression##IIO", CmImageIO::getExrCompressionNames(), &selCompression, false))
+            CmImageIO::setExrCompression((ExrCompression)selCompression);
+        if (ImGui::IsItemHovered())
+            ImGui::SetTooltip("Compression for OpenEXR images");
+
     }
 
     imGuiDiv();
@@ -1176,6 +1214,26 @@ void layoutDiffraction()
     imGuiBold("DIFFRACTION");
 
     ImGui::Checkbox("Logarithmic Normalization##Diff", &diffParams->logNorm);
+    ImGui::Checkbox("Spectral##Diff", &diffParams->spectral);
+
+    if (diffParams->spectral)
+    {
+        if (ImGui::SliderFloat("Amount##Diff", &diffParams->spectralAmount, 0.0f, 1.0f))
+            diffParams->spectralAmount = fmaxf(diffParams->spectralAmount, 0.0f);
+
+        if (ImGui::SliderFloat("Edge Offset##Diff", &diffParams->spectralEdgeOffset, -1.0f, 1.0f))
+            diffParams->spectralEdgeOffset = std::clamp(diffParams->spectralEdgeOffset, -1.0f, 1.0f);
+
+        if (imGuiSliderUInt("Steps##Diff", &diffParams->spectralSteps, 32, 1024))
+            diffParams->spectralSteps = std::clamp(diffParams->spectralSteps, 1u, RealBloom::DIFF_MAX_SPECTRAL_STEPS);
+    }
+    else
+    {
+        ImGui::Checkbox("Double Precision##Diff", &diffParams->doublePrecision);
+        ImGui::Checkbox("Fast FFT Size##Diff", &diffParams->fastSize);
+        if (diffParams->fastSize)
+            ImGui::Checkbox("Resample to Input Size##Diff", &diffParams->resample);
+    }
 
     if (ImGui::Button("Compute##Diff", btnSize()))
     {
@@ -1203,6 +1261,28 @@ void layoutDebug()
 
     ImGui::Checkbox("Image Transform: Use GPU##Debug", &ImageTransform::S_USE_GPU);
 
+    // Baked view transform (CPU)
+    {
+        static const std::vector<std::string> lutSizeNames{ "Off", "17", "33", "65", "129" };
+        static const std::vector<uint32_t> lutSizes{ 0, 17, 33, 65, 129 };
+
+        int selLutSize = findIndex(lutSizes, CMS::getViewLutSize());
+        if (selLutSize < 0) selLutSize = 0;
+
+        if (imGuiCombo("View Transform LUT##Debug", lutSizeNames, &selLutSize, false))
+        {
+            CMS::setViewLutSize(lutSizes[selLutSize]);
+            Config::VIEW_LUT_SIZE = CMS::getViewLutSize();
+            CMS::updateProcessors();
+            for (auto& slot : slots)
+                slot.viewImage->updateView();
+        }
+
+        std::shared_ptr<const CmLut3D> viewLut = CMS::getViewLut();
+        if (viewLut)
+            ImGui::Text("LUT Max Error: %.6f", viewLut->getMaxError());
+    }
+
     ImGui::End();
 }
 
@@ -1910,6 +1990,7 @@ void cleanUp()
     CmImageIO::cleanUp();
     CMF::cleanUp();
     CMS::cleanUp();
+    BufferPool::cleanUp();
 
     GlFullPlaneVertices::cleanUp();
 
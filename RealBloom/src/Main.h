@@ -51,6 +51,8 @@
 
 #include "Utils/FileDialogs.h"
 #include "Utils/ImageTransform.h"
+#include "Utils/BufferPool.h"
+#include "Utils/LazyInit.h"
 #include "Utils/NumberHelpers.h"
 #include "Utils/Misc.h"
 
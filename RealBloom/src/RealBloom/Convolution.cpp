@@ -85,14 +85,15 @@ namespace RealBloom
 
         {
             // Input image
-            std::scoped_lock lock1(*m_imgInput);
-            float* inputBuffer = m_imgInput->getImageData();
+            std::shared_lock lock1(*m_imgInput);
+            const float* inputBuffer = m_imgInput->getConstImageData();
             uint32_t inputWidth = m_imgInput->getWidth();
             uint32_t inputHeight = m_imgInput->getHeight();
 
             // Convolution Preview Image
             std::scoped_lock lock2(*m_imgConvPreview);
             m_imgConvPreview->resize(inputWidth, inputHeight, false);
+            m_imgConvPreview->setStorageFormat(CmPixelFormat::RGBA16F, false);
             float* prevBuffer = m_imgConvPreview->getImageData();
 
 #pragma omp parallel for
@@ -122,12 +123,12 @@ namespace RealBloom
             *outNumPixels = numPixels;
     }
 
-    void Convolution::previewInput(bool previewMode, std::vector<float>* outBuffer, uint32_t* outWidth, uint32_t* outHeight)
+    void Convolution::previewInput(bool previewMode, CmSharedBuffer* outBuffer, uint32_t* outWidth, uint32_t* outHeight)
     {
-        processInputImage(previewMode, m_params.inputTransformParams, m_imgInputSrc, *m_imgInput, outBuffer, outWidth, outHeight);
+        processInputImage(previewMode, m_params.inputTransformParams, m_imgInputSrc, *m_imgInput, outBuffer, outWidth, outHeight, &m_inputTransformCache);
     }
 
-    void Convolution::previewKernel(bool previewMode, std::vector<float>* outBuffer, uint32_t* outWidth, uint32_t* outHeight)
+    void Convolution::previewKernel(bool previewMode, CmSharedBuffer* outBuffer, uint32_t* outWidth, uint32_t* outHeight)
     {
         // Return the output dimensions if requested
         if (!previewMode && !outBuffer)
@@ -139,13 +140,15 @@ namespace RealBloom
             return;
         }
 
-        processInputImage(previewMode, m_params.kernelTransformParams, m_imgKernelSrc, *m_imgKernel, outBuffer, outWidth, outHeight);
+        processInputImage(previewMode, m_params.kernelTransformParams, m_imgKernelSrc, *m_imgKernel, outBuffer, outWidth, outHeight, &m_kernelTransformCache);
 
         bool outerRequest = (!previewMode && outBuffer && outWidth && outHeight);
 
         // Auto-adjust the exposure
         if (m_params.autoExposure && outerRequest)
         {
+            const FloatBuffer& kernelBuffer = **outBuffer;
+
             // Get the sum of the grayscale values
             float sumV = 0.0f;
             for (uint32_t y = 0; y < *outHeight; y++)
@@ -154,20 +157,26 @@ namespace RealBloom
                 {
                     uint32_t redIndex = (y * *outWidth + x) * 4;
 
-                    float grayscale = rgbaToGrayscale(&(*outBuffer)[redIndex], GrayscaleType::Average);
+                    float grayscale = rgbaToGrayscale(&kernelBuffer[redIndex], GrayscaleType::Average);
                     sumV += grayscale;
                 }
             }
 
-            // Divide by the sum, and cancel out the convolution multiplier
+            // Divide by the sum, and cancel out the convolution multiplier.
+            // The buffer is shared with the cache, so the result is written
+            // to a new one.
             if (sumV != 0.0f)
             {
                 float mul = 1.0 / ((double)sumV * (double)CONV_MULTIPLIER);
-                for (uint32_t i = 0; i < (*outBuffer).size(); i++)
+                std::vector<float> adjustedBuffer(kernelBuffer.size());
+                for (uint32_t i = 0; i < kernelBuffer.size(); i++)
                 {
                     if (i % 4 != 3)
-                        (*outBuffer)[i] *= mul;
+                        adjustedBuffer[i] = kernelBuffer[i] * mul;
+                    else
+                        adjustedBuffer[i] = kernelBuffer[i];
                 }
+                *outBuffer = std::make_shared<FloatBuffer>(std::move(adjustedBuffer));
             }
         }
     }
@@ -188,14 +197,14 @@ namespace RealBloom
 
         {
             // Input buffer
-            std::scoped_lock lock1(m_imgInputCaptured);
-            float* inputBuffer = m_imgInputCaptured.getImageData();
+            std::shared_lock lock1(m_imgInputCaptured);
+            const float* inputBuffer = m_imgInputCaptured.getConstImageData();
             uint32_t inputWidth = m_imgInputCaptured.getWidth();
             uint32_t inputHeight = m_imgInputCaptured.getHeight();
 
             // Conv. Buffer
-            std::scoped_lock lock2(m_imgOutput);
-            float* convBuffer = m_imgOutput.getImageData();
+            std::shared_lock lock2(m_imgOutput);
+            const float* convBuffer = m_imgOutput.getConstImageData();
             uint32_t convWidth = m_imgOutput.getWidth();
             uint32_t convHeight = m_imgOutput.getHeight();
 
@@ -204,6 +213,7 @@ namespace RealBloom
                 // Conv. Result Buffer
                 std::scoped_lock lock3(*m_imgConvResult);
                 m_imgConvResult->resize(inputWidth, inputHeight, false);
+                m_imgConvResult->setStorageFormat(CmPixelFormat::RGB32F, false);
                 float* convResultBuffer = m_imgConvResult->getImageData();
 
                 float mul = blendConv * getExposureMul(blendExposure);
@@ -245,13 +255,13 @@ namespace RealBloom
         m_thread = std::make_shared<std::jthread>([this]()
             {
                 // Input buffer
-                std::vector<float> inputBuffer;
+                CmSharedBuffer inputBuffer;
                 uint32_t inputWidth = 0, inputHeight = 0;
                 previewInput(false, &inputBuffer, &inputWidth, &inputHeight);
                 uint32_t inputBufferSize = inputWidth * inputHeight * 4;
 
                 // Kernel buffer
-                std::vector<float> kernelBuffer;
+                CmSharedBuffer kernelBuffer;
                 uint32_t kernelWidth = 0, kernelHeight = 0;
                 previewKernel(false, &kernelBuffer, &kernelWidth, &kernelHeight);
                 uint32_t kernelBufferSize = kernelWidth * kernelHeight * 4;
@@ -261,23 +271,23 @@ namespace RealBloom
                 {
                 case RealBloom::ConvolutionMethod::FFT_CPU:
                     convFftCPU(
-                        kernelBuffer, kernelWidth, kernelHeight,
-                        inputBuffer, inputWidth, inputHeight, inputBufferSize);
+                        *kernelBuffer, kernelWidth, kernelHeight,
+                        *inputBuffer, inputWidth, inputHeight, inputBufferSize);
                     break;
                 case RealBloom::ConvolutionMethod::FFT_GPU:
                     convFftGPU(
-                        kernelBuffer, kernelWidth, kernelHeight,
-                        inputBuffer, inputWidth, inputHeight, inputBufferSize);
+                        *kernelBuffer, kernelWidth, kernelHeight,
+                        *inputBuffer, inputWidth, inputHeight, inputBufferSize);
                     break;
                 case RealBloom::ConvolutionMethod::NAIVE_CPU:
                     convNaiveCPU(
-                        kernelBuffer, kernelWidth, kernelHeight,
-                        inputBuffer, inputWidth, inputHeight, inputBufferSize);
+                        *kernelBuffer, kernelWidth, kernelHeight,
+                        *inputBuffer, inputWidth, inputHeight, inputBufferSize);
                     break;
                 case RealBloom::ConvolutionMethod::NAIVE_GPU:
                     convNaiveGPU(
-                        kernelBuffer, kernelWidth, kernelHeight,
-                        inputBuffer, inputWidth, inputHeight, inputBufferSize);
+                        *kernelBuffer, kernelWidth, kernelHeight,
+                        *inputBuffer, inputWidth, inputHeight, inputBufferSize);
                     break;
                 default:
                     break;
@@ -286,9 +296,7 @@ namespace RealBloom
                 // Update the captured input image, used for blending
                 {
                     std::scoped_lock lock(m_imgInputCaptured);
-                    m_imgInputCaptured.resize(inputWidth, inputHeight, false);
-                    float* buffer = m_imgInputCaptured.getImageData();
-                    std::copy(inputBuffer.data(), inputBuffer.data() + inputBufferSize, buffer);
+                    m_imgInputCaptured.setImageData(inputBuffer, inputWidth, inputHeight);
                 }
 
                 // Update convBlendParamsChanged
@@ -498,10 +506,10 @@ namespace RealBloom
     }
 
     void Convolution::convFftCPU(
-        std::vector<float>& kernelBuffer,
+        const FloatBuffer& kernelBuffer,
         uint32_t kernelWidth,
         uint32_t kernelHeight,
-        std::vector<float>& inputBuffer,
+        const FloatBuffer& inputBuffer,
         uint32_t inputWidth,
         uint32_t inputHeight,
         uint32_t inputBufferSize)
@@ -586,10 +594,10 @@ namespace RealBloom
     }
 
     void Convolution::convFftGPU(
-        std::vector<float>& kernelBuffer,
+        const FloatBuffer& kernelBuffer,
         uint32_t kernelWidth,
         uint32_t kernelHeight,
-        std::vector<float>& inputBuffer,
+        const FloatBuffer& inputBuffer,
         uint32_t inputWidth,
         uint32_t inputHeight,
         uint32_t inputBufferSize)
@@ -614,8 +622,8 @@ namespace RealBloom
             binInput.inputHeight = inputHeight;
             binInput.kernelWidth = kernelWidth;
             binInput.kernelHeight = kernelHeight;
-            binInput.inputBuffer = inputBuffer;
-            binInput.kernelBuffer = kernelBuffer;
+            binInput.inputBuffer.assign(inputBuffer.begin(), inputBuffer.end());
+            binInput.kernelBuffer.assign(kernelBuffer.begin(), kernelBuffer.end());
 
             // Create the input file
             std::ofstream inpFile;
@@ -702,10 +710,10 @@ namespace RealBloom
     }
 
     void Convolution::convNaiveCPU(
-        std::vector<float>& kernelBuffer,
+        const FloatBuffer& kernelBuffer,
         uint32_t kernelWidth,
         uint32_t kernelHeight,
-        std::vector<float>& inputBuffer,
+        const FloatBuffer& inputBuffer,
         uint32_t inputWidth,
         uint32_t inputHeight,
         uint32_t inputBufferSize)
@@ -717,18 +725,21 @@ namespace RealBloom
         if (numThreads < 1) numThreads = 1;
         m_capturedParams.methodInfo.NAIVE_CPU_numThreads = numThreads;
 
+        // The threads work on RGB planes
+        PlanarImage<float> inputPlanes;
+        inputPlanes.resize(inputWidth, inputHeight, 3);
+        inputPlanes.deinterleave(inputBuffer.data(), inputWidth, inputHeight);
+
+        PlanarImage<float> kernelPlanes;
+        kernelPlanes.resize(kernelWidth, kernelHeight, 3);
+        kernelPlanes.deinterleave(kernelBuffer.data(), kernelWidth, kernelHeight);
+
         // Create and prepare threads
         for (uint32_t i = 0; i < numThreads; i++)
         {
             std::shared_ptr<ConvolutionThread> ct = std::make_shared<ConvolutionThread>(
                 numThreads, i, m_capturedParams,
-                inputBuffer.data(), inputWidth, inputHeight,
-                kernelBuffer.data(), kernelWidth, kernelHeight);
-
-            std::vector<float>& threadBuffer = ct->getBuffer();
-            threadBuffer.resize(inputBufferSize);
-            for (uint32_t j = 0; j < inputBufferSize; j++)
-                threadBuffer[j] = (j % 4 == 3) ? 1.0f : 0.0f;
+                &inputPlanes, &kernelPlanes);
 
             m_cpuThreads.push_back(ct);
         }
@@ -745,6 +756,15 @@ namespace RealBloom
             ct->setThread(t);
         }
 
+        // An input row only changes the output rows the kernel lands on
+        std::array<float, 2> kernelOrigin = getKernelOrigin(m_capturedParams);
+        int kernelOriginY = (int)floorf(kernelOrigin[1] * (float)kernelHeight);
+
+        // Rows above progRow were in the last snapshot, which left the result
+        // image at progGeneration
+        uint32_t progRow = 0;
+        uint64_t progGeneration = 0;
+
         // Wait for the threads
         std::chrono::time_point<std::chrono::system_clock> lastProgTime = std::chrono::system_clock::now();
         while (true)
@@ -773,34 +793,69 @@ namespace RealBloom
 
             if (mustUpdateProg)
             {
-                std::vector<float> progBuffer;
-                progBuffer.resize(inputBufferSize);
-                for (uint32_t i = 0; i < inputBufferSize; i++)
-                    progBuffer[i] = (i % 4 == 3) ? 1.0f : 0.0f;
-
+                // Input rows convolved since the last snapshot
+                uint32_t minRow = inputHeight, maxRow = 0;
                 for (auto& ct : m_cpuThreads)
                 {
-                    std::vector<float>& currentBuffer = ct->getBuffer();
-                    for (uint32_t y = 0; y < inputHeight; y++)
-                    {
-                        for (uint32_t x = 0; x < inputWidth; x++)
-                        {
-                            uint32_t redIndex = (y * inputWidth + x) * 4;
-                            progBuffer[redIndex + 0] += currentBuffer[redIndex + 0] * CONV_MULTIPLIER;
-                            progBuffer[redIndex + 1] += currentBuffer[redIndex + 1] * CONV_MULTIPLIER;
-                            progBuffer[redIndex + 2] += currentBuffer[redIndex + 2] * CONV_MULTIPLIER;
-                        }
-                    }
+                    uint32_t row = ct->getStats()->currentRow;
+                    minRow = std::min(minRow, row);
+                    maxRow = std::max(maxRow, std::min(row + 1, inputHeight));
                 }
 
+                // Output rows they could have changed
+                int y1 = std::clamp((int)progRow - kernelOriginY, 0, (int)inputHeight);
+                int y2 = std::clamp((int)maxRow - kernelOriginY + (int)kernelHeight, 0, (int)inputHeight);
+
                 // Update Conv. Result
                 {
                     std::scoped_lock lock(*m_imgConvResult);
-                    m_imgConvResult->resize(inputWidth, inputHeight, false);
-                    float* convResultBuffer = m_imgConvResult->getImageData();
-                    std::copy(progBuffer.data(), progBuffer.data() + inputBufferSize, convResultBuffer);
+
+                    // Everything on the first snapshot, or if the image was
+                    // changed by something else since the last one
+                    bool fullUpdate = (progGeneration == 0)
+                        || (m_imgConvResult->getGeneration() != progGeneration)
+                        || (m_imgConvResult->getWidth() != inputWidth)
+                        || (m_imgConvResult->getHeight() != inputHeight);
+
+                    if (fullUpdate)
+                    {
+                        PlanarImage<float> progBuffer;
+                        progBuffer.resize(inputWidth, inputHeight, 3);
+                        for (auto& ct : m_cpuThreads)
+                            progBuffer.add(ct->getBuffer(), CONV_MULTIPLIER);
+
+                        m_imgConvResult->resize(inputWidth, inputHeight, false);
+                        progBuffer.interleave(m_imgConvResult->getImageData());
+                        m_imgConvResult->moveToGPU();
+                    }
+                    else if (y2 > y1)
+                    {
+                        // Only the rows that changed are summed and uploaded
+                        float* resultData = m_imgConvResult->getImageData();
+
+#pragma omp parallel for
+                        for (int y = y1; y < y2; y++)
+                        {
+                            float* resultRow = resultData + ((size_t)y * inputWidth * 4);
+                            for (uint32_t x = 0; x < inputWidth; x++)
+                            {
+                                for (uint32_t ch = 0; ch < 3; ch++)
+                                {
+                                    float v = 0.0f;
+                                    for (auto& ct : m_cpuThreads)
+                                        v += ct->getBuffer()(ch, y, x);
+                                    resultRow[(x * 4) + ch] = v * CONV_MULTIPLIER;
+                                }
+                                resultRow[(x * 4) + 3] = 1.0f;
+                            }
+                        }
+
+                        m_imgConvResult->moveToGPU(0, y1, inputWidth, y2 - y1);
+                    }
+
+                    progRow = minRow;
+                    progGeneration = m_imgConvResult->getGeneration();
                 }
-                m_imgConvResult->moveToGPU();
 
                 lastProgTime = std::chrono::system_clock::now();
             }
@@ -814,26 +869,15 @@ namespace RealBloom
 
         // Update the output image
         {
-            std::scoped_lock lock(m_imgOutput);
-            m_imgOutput.resize(inputWidth, inputHeight, false);
-            m_imgOutput.fill(std::array<float, 4>{ 0.0f, 0.0f, 0.0f, 1.0f }, false);
-            float* convBuffer = m_imgOutput.getImageData();
-
             // Add the buffers from each thread
+            PlanarImage<float> convPlanes;
+            convPlanes.resize(inputWidth, inputHeight, 3);
             for (auto& ct : m_cpuThreads)
-            {
-                std::vector<float>& currentBuffer = ct->getBuffer();
-                for (uint32_t y = 0; y < inputHeight; y++)
-                {
-                    for (uint32_t x = 0; x < inputWidth; x++)
-                    {
-                        uint32_t redIndex = (y * inputWidth + x) * 4;
-                        convBuffer[redIndex + 0] += currentBuffer[redIndex + 0] * CONV_MULTIPLIER;
-                        convBuffer[redIndex + 1] += currentBuffer[redIndex + 1] * CONV_MULTIPLIER;
-                        convBuffer[redIndex + 2] += currentBuffer[redIndex + 2] * CONV_MULTIPLIER;
-                    }
-                }
-            }
+                convPlanes.add(ct->getBuffer(), CONV_MULTIPLIER);
+
+            std::scoped_lock lock(m_imgOutput);
+            m_imgOutput.resize(inputWidth, inputHeight, false);
+            convPlanes.interleave(m_imgOutput.getImageData());
         }
 
         // Clean up
@@ -841,10 +885,10 @@ namespace RealBloom
     }
 
     void Convolution::convNaiveGPU(
-        std::vector<float>& kernelBuffer,
+        const FloatBuffer& kernelBuffer,
         uint32_t kernelWidth,
         uint32_t kernelHeight,
-        std::vector<float>& inputBuffer,
+        const FloatBuffer& inputBuffer,
         uint32_t inputWidth,
         uint32_t inputHeight,
         uint32_t inputBufferSize)
@@ -890,8 +934,8 @@ namespace RealBloom
             binInput.inputHeight = inputHeight;
             binInput.kernelWidth = kernelWidth;
             binInput.kernelHeight = kernelHeight;
-            binInput.inputBuffer = inputBuffer;
-            binInput.kernelBuffer = kernelBuffer;
+            binInput.inputBuffer.assign(inputBuffer.begin(), inputBuffer.end());
+            binInput.kernelBuffer.assign(kernelBuffer.begin(), kernelBuffer.end());
 
             // Mutex for IO operations on the stat file
 
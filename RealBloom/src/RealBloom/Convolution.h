@@ -111,8 +111,8 @@ namespace RealBloom
         void setImgConvResult(CmImage* image);
 
         void previewThreshold(size_t* outNumPixels = nullptr);
-        void previewInput(bool previewMode = true, std::vector<float>* outBuffer = nullptr, uint32_t* outWidth = nullptr, uint32_t* outHeight = nullptr);
-        void previewKernel(bool previewMode = true, std::vector<float>* outBuffer = nullptr, uint32_t* outWidth = nullptr, uint32_t* outHeight = nullptr);
+        void previewInput(bool previewMode = true, CmSharedBuffer* outBuffer = nullptr, uint32_t* outWidth = nullptr, uint32_t* outHeight = nullptr);
+        void previewKernel(bool previewMode = true, CmSharedBuffer* outBuffer = nullptr, uint32_t* outWidth = nullptr, uint32_t* outHeight = nullptr);
         void blend();
         void convolve();
         void cancel();
@@ -133,9 +133,11 @@ namespace RealBloom
 
         CmImage m_imgInputSrc;
         CmImage* m_imgInput = nullptr;
+        TransformCache m_inputTransformCache;
 
         CmImage m_imgKernelSrc;
         CmImage* m_imgKernel = nullptr;
+        TransformCache m_kernelTransformCache;
 
         CmImage* m_imgConvPreview = nullptr;
         CmImage* m_imgConvResult = nullptr;
@@ -148,37 +150,37 @@ namespace RealBloom
 
     private:
         void convFftCPU(
-            std::vector<float>& kernelBuffer,
+            const FloatBuffer& kernelBuffer,
             uint32_t kernelWidth,
             uint32_t kernelHeight,
-            std::vector<float>& inputBuffer,
+            const FloatBuffer& inputBuffer,
             uint32_t inputWidth,
             uint32_t inputHeight,
             uint32_t inputBufferSize);
 
         void convFftGPU(
-            std::vector<float>& kernelBuffer,
+            const FloatBuffer& kernelBuffer,
             uint32_t kernelWidth,
             uint32_t kernelHeight,
-            std::vector<float>& inputBuffer,
+            const FloatBuffer& inputBuffer,
             uint32_t inputWidth,
             uint32_t inputHeight,
             uint32_t inputBufferSize);
 
         void convNaiveCPU(
-            std::vector<float>& kernelBuffer,
+            const FloatBuffer& kernelBuffer,
             uint32_t kernelWidth,
             uint32_t kernelHeight,
-            std::vector<float>& inputBuffer,
+            const FloatBuffer& inputBuffer,
             uint32_t inputWidth,
             uint32_t inputHeight,
             uint32_t inputBufferSize);
 
         void convNaiveGPU(
-            std::vector<float>& kernelBuffer,
+            const FloatBuffer& kernelBuffer,
             uint32_t kernelWidth,
             uint32_t kernelHeight,
-            std::vector<float>& inputBuffer,
+            const FloatBuffer& inputBuffer,
             uint32_t inputWidth,
             uint32_t inputHeight,
             uint32_t inputBufferSize);
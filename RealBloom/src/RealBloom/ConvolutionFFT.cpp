@@ -5,7 +5,7 @@
 namespace RealBloom
 {
 
-    ConvolutionFFT::ConvolutionFFT(ConvolutionParams& convParams, float* inputBuffer, uint32_t inputWidth, uint32_t inputHeight, float* kernelBuffer, uint32_t kernelWidth, uint32_t kernelHeight)
+    ConvolutionFFT::ConvolutionFFT(ConvolutionParams& convParams, const float* inputBuffer, uint32_t inputWidth, uint32_t inputHeight, const float* kernelBuffer, uint32_t kernelWidth, uint32_t kernelHeight)
         : m_params(convParams),
         m_inputBuffer(inputBuffer), m_inputWidth(inputWidth), m_inputHeight(inputHeight),
         m_kernelBuffer(kernelBuffer), m_kernelWidth(kernelWidth), m_kernelHeight(kernelHeight)
@@ -56,22 +56,26 @@ namespace RealBloom
         {
             for (uint32_t i = 0; i < 3; i++)
             {
-                m_inputPadded[i].resize(m_paddedHeight, m_paddedWidth);
-                for (auto& v : m_inputPadded[i].getVector()) v = 0;
+                m_inputPadded[i].resize(m_paddedWidth, m_paddedHeight, 1);
+                m_inputPadded[i].deinterleave(m_inputBuffer, m_inputWidth, m_inputHeight, i, m_inputLeftPadding, m_inputTopPadding);
             }
 
             float threshold = m_params.threshold;
             float transKnee = transformKnee(m_params.knee);
 
-            float inpColor[3];
+#pragma omp parallel for
             for (int y = 0; y < (int)m_inputHeight; y++)
             {
-                for (int x = 0; x < (int)m_inputWidth; x++)
+                float* r = m_inputPadded[0].getRow(0, y + m_inputTopPadding) + m_inputLeftPadding;
+                float* g = m_inputPadded[1].getRow(0, y + m_inputTopPadding) + m_inputLeftPadding;
+                float* b = m_inputPadded[2].getRow(0, y + m_inputTopPadding) + m_inputLeftPadding;
+
+                float inpColor[3];
+                for (uint32_t x = 0; x < m_inputWidth; x++)
                 {
-                    uint32_t redIndex = (y * m_inputWidth + x) * 4;
-                    inpColor[0] = m_inputBuffer[redIndex + 0];
-                    inpColor[1] = m_inputBuffer[redIndex + 1];
-                    inpColor[2] = m_inputBuffer[redIndex + 2];
+                    inpColor[0] = r[x];
+                    inpColor[1] = g[x];
+                    inpColor[2] = b[x];
 
                     float v = rgbToGrayscale(inpColor, CONV_THRESHOLD_GRAYSCALE_TYPE);
                     if (v > threshold)
@@ -79,39 +83,25 @@ namespace RealBloom
                         // Smooth Transition
                         float mul = softThreshold(v, threshold, transKnee);
 
-                        int transX = x + m_inputLeftPadding;
-                        int transY = y + m_inputTopPadding;
-
-                        m_inputPadded[0](transY, transX) = inpColor[0] * mul;
-                        m_inputPadded[1](transY, transX) = inpColor[1] * mul;
-                        m_inputPadded[2](transY, transX) = inpColor[2] * mul;
+                        r[x] = inpColor[0] * mul;
+                        g[x] = inpColor[1] * mul;
+                        b[x] = inpColor[2] * mul;
+                    }
+                    else
+                    {
+                        r[x] = 0;
+                        g[x] = 0;
+                        b[x] = 0;
                     }
                 }
             }
         }
 
         // Kernel padding
+        for (uint32_t i = 0; i < 3; i++)
         {
-            for (uint32_t i = 0; i < 3; i++)
-            {
-                m_kernelPadded[i].resize(m_paddedHeight, m_paddedWidth);
-                for (auto& v : m_kernelPadded[i].getVector()) v = 0;
-            }
-
-            int transX, transY;
-            uint32_t redIndex;
-            for (int y = 0; y < (int)m_kernelHeight; y++)
-            {
-                for (int x = 0; x < (int)m_kernelWidth; x++)
-                {
-                    redIndex = (y * m_kernelWidth + x) * 4;
-                    transX = x + m_kernelLeftPadding;
-                    transY = y + m_kernelTopPadding;
-                    m_kernelPadded[0](transY, transX) = m_kernelBuffer[redIndex + 0];
-                    m_kernelPadded[1](transY, transX) = m_kernelBuffer[redIndex + 1];
-                    m_kernelPadded[2](transY, transX) = m_kernelBuffer[redIndex + 2];
-                }
-            }
+            m_kernelPadded[i].resize(m_paddedWidth, m_paddedHeight, 1);
+            m_kernelPadded[i].deinterleave(m_kernelBuffer, m_kernelWidth, m_kernelHeight, i, m_kernelLeftPadding, m_kernelTopPadding);
         }
     }
 
@@ -120,7 +110,7 @@ namespace RealBloom
         m_inputFT[ch].resize(m_paddedHeight, m_paddedWidth);
 
         pocketfft::shape_t shape{ m_paddedWidth, m_paddedHeight };
-        pocketfft::stride_t strideIn{ sizeof(float), (ptrdiff_t)(m_paddedWidth * sizeof(float)) };
+        pocketfft::stride_t strideIn{ sizeof(float), (ptrdiff_t)(m_inputPadded[ch].getStride() * sizeof(float)) };
         pocketfft::stride_t strideOut{ sizeof(std::complex<float>), (ptrdiff_t)(m_paddedWidth * sizeof(std::complex<float>)) };
         pocketfft::r2c(
             shape,
@@ -128,7 +118,7 @@ namespace RealBloom
             strideOut,
             { 0, 1 },
             pocketfft::FORWARD,
-            m_inputPadded[ch].getVector().data(),
+            m_inputPadded[ch].getPlane(0),
             m_inputFT[ch].getVector().data(),
             1.0f,
             0);
@@ -141,7 +131,7 @@ namespace RealBloom
         m_kernelFT[ch].resize(m_paddedHeight, m_paddedWidth);
 
         pocketfft::shape_t shape{ m_paddedWidth, m_paddedHeight };
-        pocketfft::stride_t strideIn{ sizeof(float), (ptrdiff_t)(m_paddedWidth * sizeof(float)) };
+        pocketfft::stride_t strideIn{ sizeof(float), (ptrdiff_t)(m_kernelPadded[ch].getStride() * sizeof(float)) };
         pocketfft::stride_t strideOut{ sizeof(std::complex<float>), (ptrdiff_t)(m_paddedWidth * sizeof(std::complex<float>)) };
         pocketfft::r2c(
             shape,
@@ -149,7 +139,7 @@ namespace RealBloom
             strideOut,
             { 0, 1 },
             pocketfft::FORWARD,
-            m_kernelPadded[ch].getVector().data(),
+            m_kernelPadded[ch].getPlane(0),
             m_kernelFT[ch].getVector().data(),
             1.0f,
             0);
@@ -182,11 +172,12 @@ namespace RealBloom
 
     void ConvolutionFFT::inverse(uint32_t ch)
     {
-        m_iFFT[ch].resize(m_paddedHeight, m_paddedWidth);
+        if (m_iFFT.getNumPlanes() != 3)
+            m_iFFT.resize(m_paddedWidth, m_paddedHeight, 3);
 
         pocketfft::shape_t shape{ m_paddedWidth, m_paddedHeight };
         pocketfft::stride_t strideIn{ sizeof(std::complex<float>), (ptrdiff_t)(m_paddedWidth * sizeof(std::complex<float>)) };
-        pocketfft::stride_t strideOut{ sizeof(float), (ptrdiff_t)(m_paddedWidth * sizeof(float)) };
+        pocketfft::stride_t strideOut{ sizeof(float), (ptrdiff_t)(m_iFFT.getStride() * sizeof(float)) };
         float fftScale = 1.0f / ((float)m_paddedWidth * (float)m_paddedHeight);
         pocketfft::c2r(
             shape,
@@ -195,7 +186,7 @@ namespace RealBloom
             { 0, 1 },
             pocketfft::BACKWARD,
             m_mulFT[ch].getVector().data(),
-            m_iFFT[ch].getVector().data(),
+            m_iFFT.getPlane(ch),
             fftScale,
             0);
 
@@ -209,40 +200,36 @@ namespace RealBloom
         m_outputBuffer.resize(outputSize);
 
         // Crop the iFFT output and apply convolution multiplier
-        int transX1 = 0, transY1 = 0;
-        int transX2 = 0, transY2 = 0;
-        uint32_t redIndex;
-        for (uint32_t y = 0; y < m_inputHeight; y++)
+#pragma omp parallel for
+        for (int y = 0; y < (int)m_inputHeight; y++)
         {
-            for (uint32_t x = 0; x < m_inputWidth; x++)
-            {
-                transX1 = x + m_inputLeftPadding;
-                transY1 = y + m_inputTopPadding;
+            // Fix the coordinates
+            int transY1 = y + m_inputTopPadding;
+            int transY2 = (transY1 < ((int)m_paddedHeight / 2))
+                ? (transY1 + (m_paddedHeight / 2))
+                : (transY1 - (m_paddedHeight / 2));
 
-                // Fix the coordinates
-                {
-                    if (transX1 < ((int)m_paddedWidth / 2))
-                        transX2 = transX1 + (m_paddedWidth / 2);
-                    else
-                        transX2 = transX1 - (m_paddedWidth / 2);
+            const float* rows[3];
+            for (uint32_t i = 0; i < 3; i++)
+                rows[i] = m_iFFT.getRow(i, transY2);
 
-                    if (transY1 < ((int)m_paddedHeight / 2))
-                        transY2 = transY1 + (m_paddedHeight / 2);
-                    else
-                        transY2 = transY1 - (m_paddedHeight / 2);
-                }
+            float* target = m_outputBuffer.data() + ((size_t)y * m_inputWidth * 4);
+            for (uint32_t x = 0; x < m_inputWidth; x++)
+            {
+                int transX1 = x + m_inputLeftPadding;
+                int transX2 = (transX1 < ((int)m_paddedWidth / 2))
+                    ? (transX1 + (m_paddedWidth / 2))
+                    : (transX1 - (m_paddedWidth / 2));
 
                 // Get the output
-                redIndex = (y * m_inputWidth + x) * 4;
-                m_outputBuffer[redIndex + 0] = m_iFFT[0](transY2, transX2) * CONV_MULTIPLIER;
-                m_outputBuffer[redIndex + 1] = m_iFFT[1](transY2, transX2) * CONV_MULTIPLIER;
-                m_outputBuffer[redIndex + 2] = m_iFFT[2](transY2, transX2) * CONV_MULTIPLIER;
-                m_outputBuffer[redIndex + 3] = 1.0f;
+                target[(x * 4) + 0] = rows[0][transX2] * CONV_MULTIPLIER;
+                target[(x * 4) + 1] = rows[1][transX2] * CONV_MULTIPLIER;
+                target[(x * 4) + 2] = rows[2][transX2] * CONV_MULTIPLIER;
+                target[(x * 4) + 3] = 1.0f;
             }
         }
 
-        for (uint32_t i = 0; i < 3; i++)
-            m_iFFT[i].reset();
+        m_iFFT.reset();
     }
 
     const std::vector<float>& ConvolutionFFT::getBuffer() const
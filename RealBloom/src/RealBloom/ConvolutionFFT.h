@@ -12,6 +12,7 @@
 
 #include "Convolution.h"
 #include "../Utils/Array2D.h"
+#include "../Utils/PlanarImage.h"
 #include "../Utils/NumberHelpers.h"
 #include "../Utils/Misc.h"
 
@@ -24,8 +25,8 @@ namespace RealBloom
     public:
         ConvolutionFFT(
             ConvolutionParams& convParams,
-            float* inputBuffer, uint32_t inputWidth, uint32_t inputHeight,
-            float* kernelBuffer, uint32_t kernelWidth, uint32_t kernelHeight);
+            const float* inputBuffer, uint32_t inputWidth, uint32_t inputHeight,
+            const float* kernelBuffer, uint32_t kernelWidth, uint32_t kernelHeight);
         ~ConvolutionFFT();
 
         void pad();
@@ -40,11 +41,11 @@ namespace RealBloom
     private:
         ConvolutionParams m_params;
 
-        float* m_inputBuffer;
+        const float* m_inputBuffer;
         uint32_t m_inputWidth;
         uint32_t m_inputHeight;
 
-        float* m_kernelBuffer;
+        const float* m_kernelBuffer;
         uint32_t m_kernelWidth;
         uint32_t m_kernelHeight;
 
@@ -55,13 +56,14 @@ namespace RealBloom
         uint32_t m_kernelLeftPadding = 0;
         uint32_t m_kernelTopPadding = 0;
 
-        Array2D<float> m_inputPadded[3];
-        Array2D<float> m_kernelPadded[3];
+        // One plane each, released once the channel is transformed
+        PlanarImage<float> m_inputPadded[3];
+        PlanarImage<float> m_kernelPadded[3];
 
         Array2D<std::complex<float>> m_inputFT[3];
         Array2D<std::complex<float>> m_kernelFT[3];
         Array2D<std::complex<float>> m_mulFT[3];
-        Array2D<float> m_iFFT[3];
+        PlanarImage<float> m_iFFT;
 
         std::vector<float> m_outputBuffer;
 
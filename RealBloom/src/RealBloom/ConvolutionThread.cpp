@@ -6,13 +6,14 @@ namespace RealBloom
 
     ConvolutionThread::ConvolutionThread(
         uint32_t numThreads, uint32_t threadIndex, const ConvolutionParams& params,
-        float* inputBuffer, uint32_t inputWidth, uint32_t inputHeight,
-        float* kernelBuffer, uint32_t kernelWidth, uint32_t kernelHeight)
+        const PlanarImage<float>* input, const PlanarImage<float>* kernel)
         : m_numThreads(numThreads), m_threadIndex(threadIndex),
         m_params(params),
-        m_inputBuffer(inputBuffer), m_inputWidth(inputWidth), m_inputHeight(inputHeight),
-        m_kernelBuffer(kernelBuffer), m_kernelWidth(kernelWidth), m_kernelHeight(kernelHeight)
-    {}
+        m_input(input), m_inputWidth(input->getWidth()), m_inputHeight(input->getHeight()),
+        m_kernel(kernel), m_kernelWidth(kernel->getWidth()), m_kernelHeight(kernel->getHeight())
+    {
+        m_outputBuffer.resize(m_inputWidth, m_inputHeight, 3);
+    }
 
     void ConvolutionThread::start()
     {
@@ -20,6 +21,7 @@ namespace RealBloom
             return;
 
         m_state.state = ConvolutionThreadState::Initializing;
+        m_state.currentRow = 0;
         m_mustStop = false;
 
         // Parameters
@@ -39,15 +41,15 @@ namespace RealBloom
 
             float v;
             float inpColor[3];
-            uint32_t redIndexInput;
             for (uint32_t i = 0; i < inputPixels; i++)
             {
                 if (i % m_numThreads == m_threadIndex)
                 {
-                    redIndexInput = i * 4;
-                    inpColor[0] = m_inputBuffer[redIndexInput + 0];
-                    inpColor[1] = m_inputBuffer[redIndexInput + 1];
-                    inpColor[2] = m_inputBuffer[redIndexInput + 2];
+                    uint32_t ix = i % m_inputWidth;
+                    uint32_t iy = i / m_inputWidth;
+                    inpColor[0] = (*m_input)(0, iy, ix);
+                    inpColor[1] = (*m_input)(1, iy, ix);
+                    inpColor[2] = (*m_input)(2, iy, ix);
 
                     v = rgbToGrayscale(inpColor, CONV_THRESHOLD_GRAYSCALE_TYPE);
                     if (v > threshold)
@@ -60,6 +62,7 @@ namespace RealBloom
 
         if (m_state.numPixels < 1)
         {
+            m_state.currentRow = m_inputHeight;
             m_state.state = ConvolutionThreadState::Done;
             return;
         }
@@ -70,9 +73,6 @@ namespace RealBloom
             // Convolve
             float v;
             float inpColor[3];
-            float convColor[3];
-            int redIndexInput, redIndexKernel, redIndexConv;
-            int cx, cy;
             float mul;
             for (int iy = 0; iy < (int)m_inputHeight; iy++)
             {
@@ -82,12 +82,17 @@ namespace RealBloom
                     break;
                 }
 
+                m_state.currentRow = (uint32_t)iy;
+
+                const float* inputRows[3];
+                for (uint32_t ch = 0; ch < 3; ch++)
+                    inputRows[ch] = m_input->getRow(ch, iy);
+
                 for (int ix = 0; ix < (int)m_inputWidth; ix++)
                 {
-                    redIndexInput = (iy * m_inputWidth + ix) * 4;
-                    inpColor[0] = m_inputBuffer[redIndexInput + 0];
-                    inpColor[1] = m_inputBuffer[redIndexInput + 1];
-                    inpColor[2] = m_inputBuffer[redIndexInput + 2];
+                    inpColor[0] = inputRows[0][ix];
+                    inpColor[1] = inputRows[1][ix];
+                    inpColor[2] = inputRows[2][ix];
 
                     v = rgbToGrayscale(inpColor, CONV_THRESHOLD_GRAYSCALE_TYPE);
                     if (v > threshold)
@@ -98,42 +103,7 @@ namespace RealBloom
                         inpColor[1] *= mul;
                         inpColor[2] *= mul;
 
-                        // (Disabled, seems to have no effect)
-                        // Check if we will stay inside the image boundaries
-                        // Disable bounds checking when guaranteed to stay in bounds
-
-                        /*bool willStayInside;
-                        {
-                            int rectX1 = ix - kernelCenterX;
-                            int rectY1 = iy - kernelCenterY;
-                            int rectX2 = (int)m_kernelWidth - 1 - kernelCenterX + ix;
-                            int rectY2 = (int)m_kernelHeight - 1 - kernelCenterY + iy;
-
-                            willStayInside = ((rectX1 >= 0) &&
-                                (rectY1 >= 0) &&
-                                (rectX2 < m_inputWidth) &&
-                                (rectY2 < m_inputHeight));
-                        }*/
-
-                        for (int ky = 0; ky < (int)m_kernelHeight; ky++)
-                        {
-                            for (int kx = 0; kx < (int)m_kernelWidth; kx++)
-                            {
-                                cx = (kx - kernelOriginX) + ix;
-                                cy = (ky - kernelOriginY) + iy;
-                                if (checkBounds(cx, cy, m_inputWidth, m_inputHeight))
-                                {
-                                    redIndexKernel = (ky * m_kernelWidth + kx) * 4;
-
-                                    convColor[0] = m_kernelBuffer[redIndexKernel + 0] * inpColor[0];
-                                    convColor[1] = m_kernelBuffer[redIndexKernel + 1] * inpColor[1];
-                                    convColor[2] = m_kernelBuffer[redIndexKernel + 2] * inpColor[2];
-
-                                    redIndexConv = (cy * m_inputWidth + cx) * 4;
-                                    blendAddRGB(m_outputBuffer.data(), redIndexConv, convColor, 0, 1);
-                                }
-                            }
-                        }
+                        convolvePixel(ix, iy, inpColor, kernelOriginX, kernelOriginY);
                         m_state.numDone += 1;
                     }
                 }
@@ -142,9 +112,7 @@ namespace RealBloom
         {
             float v;
             float inpColor[3];
-            float convColor[3];
-            int redIndexInput, redIndexKernel, redIndexConv;
-            int ix, iy, cx, cy;
+            int ix, iy;
             float mul;
             for (uint32_t i = 0; i < inputPixels; i++)
             {
@@ -157,10 +125,13 @@ namespace RealBloom
                 if (i % m_numThreads != m_threadIndex)
                     continue;
 
-                redIndexInput = i * 4;
-                inpColor[0] = m_inputBuffer[redIndexInput + 0];
-                inpColor[1] = m_inputBuffer[redIndexInput + 1];
-                inpColor[2] = m_inputBuffer[redIndexInput + 2];
+                ix = i % m_inputWidth;
+                iy = i / m_inputWidth;
+                m_state.currentRow = (uint32_t)iy;
+
+                inpColor[0] = (*m_input)(0, iy, ix);
+                inpColor[1] = (*m_input)(1, iy, ix);
+                inpColor[2] = (*m_input)(2, iy, ix);
 
                 v = rgbToGrayscale(inpColor, CONV_THRESHOLD_GRAYSCALE_TYPE);
                 if (v > threshold)
@@ -171,40 +142,43 @@ namespace RealBloom
                     inpColor[1] *= mul;
                     inpColor[2] *= mul;
 
-                    ix = i % m_inputWidth;
-                    iy = (i - ix) / m_inputWidth;
-                    for (int ky = 0; ky < (int)m_kernelHeight; ky++)
-                    {
-                        for (int kx = 0; kx < (int)m_kernelWidth; kx++)
-                        {
-                            cx = (kx - kernelOriginX) + ix;
-                            cy = (ky - kernelOriginY) + iy;
-                            if (checkBounds(cx, cy, m_inputWidth, m_inputHeight))
-                            {
-                                redIndexKernel = (ky * m_kernelWidth + kx) * 4;
-
-                                convColor[0] = m_kernelBuffer[redIndexKernel + 0] * inpColor[0];
-                                convColor[1] = m_kernelBuffer[redIndexKernel + 1] * inpColor[1];
-                                convColor[2] = m_kernelBuffer[redIndexKernel + 2] * inpColor[2];
-
-                                redIndexConv = (cy * m_inputWidth + cx) * 4;
-                                blendAddRGB(m_outputBuffer.data(), redIndexConv, convColor, 0, 1);
-                            }
-                        }
-                    }
+                    convolvePixel(ix, iy, inpColor, kernelOriginX, kernelOriginY);
                     m_state.numDone++;
                 }
             }
         }
+        m_state.currentRow = m_inputHeight;
         m_state.state = ConvolutionThreadState::Done;
     }
 
+    void ConvolutionThread::convolvePixel(int ix, int iy, const float* color, int kernelOriginX, int kernelOriginY)
+    {
+        // Only the part of the kernel that lands inside the image, so the
+        // inner loop has no bounds checks
+        int kxStart = std::max(kernelOriginX - ix, 0);
+        int kxEnd = std::min((int)m_inputWidth + kernelOriginX - ix, (int)m_kernelWidth);
+        int kyStart = std::max(kernelOriginY - iy, 0);
+        int kyEnd = std::min((int)m_inputHeight + kernelOriginY - iy, (int)m_kernelHeight);
+
+        for (uint32_t ch = 0; ch < 3; ch++)
+        {
+            const float c = color[ch];
+            for (int ky = kyStart; ky < kyEnd; ky++)
+            {
+                const float* kernelRow = m_kernel->getRow(ch, ky);
+                float* outputRow = m_outputBuffer.getRow(ch, (ky - kernelOriginY) + iy) + (ix - kernelOriginX);
+                for (int kx = kxStart; kx < kxEnd; kx++)
+                    outputRow[kx] += kernelRow[kx] * c;
+            }
+        }
+    }
+
     void ConvolutionThread::stop()
     {
         m_mustStop = true;
     }
 
-    std::vector<float>& ConvolutionThread::getBuffer()
+    PlanarImage<float>& ConvolutionThread::getBuffer()
     {
         return m_outputBuffer;
     }
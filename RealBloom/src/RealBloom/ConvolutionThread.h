@@ -7,6 +7,7 @@
 #include <cstdint>
 
 #include "Convolution.h"
+#include "../Utils/PlanarImage.h"
 #include "../Utils/NumberHelpers.h"
 
 namespace RealBloom
@@ -25,6 +26,10 @@ namespace RealBloom
         ConvolutionThreadState state = ConvolutionThreadState::None;
         uint32_t numPixels = 1;
         uint32_t numDone = 0;
+
+        // Input row being convolved, the rows above it are done. The input
+        // height once the thread is done.
+        std::atomic_uint32_t currentRow = 0;
     };
 
     // Convolution Thread, used for method: Naive CPU
@@ -33,13 +38,13 @@ namespace RealBloom
     public:
         ConvolutionThread(
             uint32_t numThreads, uint32_t threadIndex, const ConvolutionParams& params,
-            float* inputBuffer, uint32_t inputWidth, uint32_t inputHeight,
-            float* kernelBuffer, uint32_t kernelWidth, uint32_t kernelHeight);
+            const PlanarImage<float>* input, const PlanarImage<float>* kernel);
 
         void start();
         void stop();
 
-        std::vector<float>& getBuffer();
+        // RGB planes, zeroed when the thread is created
+        PlanarImage<float>& getBuffer();
         std::shared_ptr<std::jthread> getThread();
         void setThread(std::shared_ptr<std::jthread> thread);
 
@@ -55,15 +60,18 @@ namespace RealBloom
 
         ConvolutionParams m_params;
 
-        float* m_inputBuffer;
+        // RGB planes
+        const PlanarImage<float>* m_input;
         uint32_t m_inputWidth;
         uint32_t m_inputHeight;
 
-        float* m_kernelBuffer;
+        const PlanarImage<float>* m_kernel;
         uint32_t m_kernelWidth;
         uint32_t m_kernelHeight;
 
-        std::vector<float> m_outputBuffer;
+        PlanarImage<float> m_outputBuffer;
+
+        void convolvePixel(int ix, int iy, const float* color, int kernelOriginX, int kernelOriginY);
 
     };
 
@@ -12,6 +12,7 @@
 #include "ModuleHelpers.h"
 
 #include "../ColorManagement/CmImage.h"
+#include "../ColorManagement/CMF.h"
 
 #include "../Utils/ImageTransform.h"
 #include "../Utils/Array2D.h"
@@ -23,11 +24,37 @@
 
 namespace RealBloom
 {
+    constexpr uint32_t DIFF_MAX_SPECTRAL_STEPS = 2048;
 
     struct DiffractionParams
     {
         ImageTransformParams inputTransformParams;
         bool logNorm = false;
+
+        // Single precision is accurate enough for display, double precision
+        // needs twice the memory and bandwidth.
+        bool doublePrecision = false;
+
+        // Pad to the nearest 2-3-5-smooth FFT size instead of the nearest
+        // odd size, and resample the result back to the input size.
+        bool fastSize = true;
+        bool resample = true;
+
+        // Compute a separate pattern for every wavelength and add them up
+        // using the active CMF table, similar to dispersion.
+        bool spectral = false;
+        float spectralAmount = 0.4f;
+        float spectralEdgeOffset = 0.0f;
+        uint32_t spectralSteps = 32;
+    };
+
+    struct DiffractionStats
+    {
+        uint32_t fftWidth = 0;
+        uint32_t fftHeight = 0;
+
+        // Stage name, elapsed time in milliseconds
+        std::vector<std::pair<std::string, float>> timings;
     };
 
     // Diffraction module
@@ -42,20 +69,28 @@ namespace RealBloom
 
         void setImgDiff(CmImage* image);
 
-        void previewInput(bool previewMode = true, std::vector<float>* outBuffer = nullptr, uint32_t* outWidth = nullptr, uint32_t* outHeight = nullptr);
+        void previewInput(bool previewMode = true, CmSharedBuffer* outBuffer = nullptr, uint32_t* outWidth = nullptr, uint32_t* outHeight = nullptr);
         void compute();
 
         const BaseStatus& getStatus() const;
+        const DiffractionStats& getStats() const;
 
     private:
         BaseStatus m_status;
         DiffractionParams m_params;
+        DiffractionStats m_stats;
 
         CmImage m_imgInputSrc;
         CmImage* m_imgInput = nullptr;
+        TransformCache m_inputTransformCache;
 
         CmImage* m_imgDiff = nullptr;
 
+        void computeSpectral(const FloatBuffer& inputBuffer, uint32_t inputWidth, uint32_t inputHeight);
+
+        template <typename T>
+        void computeFFT(const FloatBuffer& inputBuffer, uint32_t inputWidth, uint32_t inputHeight, bool grayscale);
+
     };
 
 }
@@ -0,0 +1,268 @@
+#include "DiffractionBatch.h"
+#include "DiffractionFFT.h"
+
+#include <deque>
+
+namespace RealBloom
+{
+
+    struct DiffBatchResult
+    {
+        uint32_t index = 0;
+        uint32_t workerIndex = 0;
+        CmImage* image = nullptr;
+    };
+
+    // State shared between the workers and the writer
+    struct DiffBatchContext
+    {
+        const DiffractionBatchParams* params = nullptr;
+        DiffractionBatchStats* stats = nullptr;
+        DiffBatchReadFunc readFunc;
+
+        uint32_t numItems = 0;
+        std::atomic_uint32_t nextIndex = 0;
+
+        // The first aperture is read beforehand to find the dimensions
+        CmImage* firstImage = nullptr;
+        uint32_t inputWidth = 0;
+        uint32_t inputHeight = 0;
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<DiffBatchResult> queue;
+        std::vector<bool> pending;
+        uint32_t numWorkersDone = 0;
+    };
+
+    static bool isGrayscale(const DiffractionParams& params)
+    {
+        return (params.inputTransformParams.color.grayscaleType != GrayscaleType::None)
+            && (params.inputTransformParams.color.grayscaleMix == 1.0f);
+    }
+
+    static void transformAperture(
+        const ImageTransformParams& params,
+        CmImage& image,
+        std::vector<float>& outBuffer,
+        uint32_t& outWidth,
+        uint32_t& outHeight)
+    {
+        CmSharedBuffer inputBuffer;
+        uint32_t inputWidth, inputHeight;
+        {
+            std::shared_lock lock(image);
+            inputBuffer = image.shareImageData();
+            inputWidth = image.getWidth();
+            inputHeight = image.getHeight();
+        }
+
+        // Runs on the CPU since the workers don't have an OpenGL context
+        ImageTransform::apply(params, *inputBuffer, inputWidth, inputHeight, outBuffer, outWidth, outHeight, false);
+    }
+
+    template <typename T>
+    static void diffBatchWorker(DiffBatchContext& ctx, uint32_t workerIndex, uint32_t numThreads)
+    {
+        const DiffractionParams& diffParams = ctx.params->diffParams;
+        const bool grayscale = isGrayscale(diffParams);
+
+        // Reused for every aperture
+        DiffractionFFT<T> fft(numThreads);
+        CmImage aperture;
+        CmImage result;
+        std::vector<float> inputBuffer;
+
+        while (true)
+        {
+            uint32_t index = ctx.nextIndex++;
+            if (index >= ctx.numItems)
+                break;
+
+            DiffractionBatchItem& item = ctx.stats->items[index];
+            std::chrono::system_clock::time_point startTime = std::chrono::system_clock::now();
+
+            try
+            {
+                CmImage& source = (index == 0) ? *ctx.firstImage : aperture;
+                if (index > 0)
+                    ctx.readFunc(index, aperture);
+
+                uint32_t inputWidth = 0, inputHeight = 0;
+                transformAperture(diffParams.inputTransformParams, source, inputBuffer, inputWidth, inputHeight);
+
+                if ((inputWidth != ctx.inputWidth) || (inputHeight != ctx.inputHeight))
+                    throw std::exception(strFormat(
+                        "Aperture dimensions (%u x %u) don't match the first aperture (%u x %u).",
+                        inputWidth, inputHeight, ctx.inputWidth, ctx.inputHeight).c_str());
+
+                fft.setInput(inputBuffer.data(), inputWidth, inputHeight, grayscale, diffParams.fastSize, diffParams.resample);
+                fft.transform();
+                fft.findMaxMag();
+
+                {
+                    std::scoped_lock lock(result);
+                    result.resize(fft.getOutputWidth(), fft.getOutputHeight(), false);
+                    fft.output(result.getImageData(), diffParams.logNorm);
+                }
+                result.setSourceName(source.getSourceName());
+            }
+            catch (const std::exception& e)
+            {
+                item.ok = false;
+                item.error = e.what();
+            }
+
+            item.elapsedMs = getElapsedMs(startTime);
+
+            if (!item.ok)
+                continue;
+
+            // Hand the result over to the writer and wait until it's written
+            // so the image can be reused.
+            std::unique_lock lock(ctx.mutex);
+            ctx.pending[workerIndex] = true;
+            ctx.queue.push_back({ index, workerIndex, &result });
+            ctx.cv.notify_all();
+            ctx.cv.wait(lock, [&ctx, workerIndex]() { return !ctx.pending[workerIndex]; });
+        }
+
+        std::scoped_lock lock(ctx.mutex);
+        ctx.numWorkersDone++;
+        ctx.cv.notify_all();
+    }
+
+    DiffractionBatch::DiffractionBatch()
+    {}
+
+    DiffractionBatchParams* DiffractionBatch::getParams()
+    {
+        return &m_params;
+    }
+
+    void DiffractionBatch::compute(uint32_t numItems, DiffBatchReadFunc readFunc, DiffBatchWriteFunc writeFunc)
+    {
+        m_status.reset();
+        m_stats = DiffractionBatchStats();
+        m_stats.items.resize(numItems);
+
+        try
+        {
+            if (numItems < 1)
+                throw std::exception("No apertures were given.");
+
+            if (m_params.diffParams.spectral)
+                throw std::exception("Spectral diffraction is not supported in batches.");
+
+            DiffBatchContext ctx;
+            ctx.params = &m_params;
+            ctx.stats = &m_stats;
+            ctx.readFunc = readFunc;
+            ctx.numItems = numItems;
+
+            // Read the first aperture to get the dimensions, the first
+            // worker transforms it.
+            CmImage firstImage;
+            readFunc(0, firstImage);
+            ImageTransform::getOutputDimensions(
+                m_params.diffParams.inputTransformParams,
+                firstImage.getWidth(), firstImage.getHeight(),
+                ctx.inputWidth, ctx.inputHeight);
+            ctx.firstImage = &firstImage;
+
+            if ((ctx.inputWidth < 4) || (ctx.inputHeight < 4))
+                throw std::exception("Input dimensions are too small.");
+
+            // Memory usage of a worker: source image, transform buffers,
+            // FFT buffers, and the output image
+            const bool grayscale = isGrayscale(m_params.diffParams);
+            uint64_t sourceSize = (uint64_t)firstImage.getImageDataSize() * sizeof(float);
+            uint64_t transSize = (uint64_t)ctx.inputWidth * (uint64_t)ctx.inputHeight * 4 * sizeof(float);
+            uint64_t fftSize = m_params.diffParams.doublePrecision
+                ? DiffractionFFT<double>::estimateMemory(ctx.inputWidth, ctx.inputHeight, grayscale, m_params.diffParams.fastSize)
+                : DiffractionFFT<float>::estimateMemory(ctx.inputWidth, ctx.inputHeight, grayscale, m_params.diffParams.fastSize);
+            uint64_t memoryPerWorker = sourceSize + (3 * transSize) + fftSize;
+
+            // Number of workers
+            uint32_t numThreads = std::clamp(m_params.numThreads, 1u, getMaxNumThreads());
+            uint64_t maxWorkers = std::max(m_params.memoryBudget / std::max(memoryPerWorker, (uint64_t)1), (uint64_t)1);
+            uint32_t numWorkers = (uint32_t)std::min({ (uint64_t)numThreads, (uint64_t)numItems, maxWorkers });
+            uint32_t threadsPerWorker = std::max(numThreads / numWorkers, 1u);
+
+            m_stats.numWorkers = numWorkers;
+            m_stats.threadsPerWorker = threadsPerWorker;
+            m_stats.memoryPerWorker = memoryPerWorker;
+
+            ctx.pending.resize(numWorkers, false);
+
+            // Start the workers
+            std::vector<std::shared_ptr<std::jthread>> workers;
+            for (uint32_t i = 0; i < numWorkers; i++)
+            {
+                workers.push_back(std::make_shared<std::jthread>([&ctx, i, threadsPerWorker, this]()
+                    {
+                        if (m_params.diffParams.doublePrecision)
+                            diffBatchWorker<double>(ctx, i, threadsPerWorker);
+                        else
+                            diffBatchWorker<float>(ctx, i, threadsPerWorker);
+                    }));
+            }
+
+            // Write the results on this thread
+            while (true)
+            {
+                std::unique_lock lock(ctx.mutex);
+                ctx.cv.wait(lock, [&ctx, numWorkers]() { return (!ctx.queue.empty()) || (ctx.numWorkersDone >= numWorkers); });
+
+                if (ctx.queue.empty())
+                    break;
+
+                DiffBatchResult entry = ctx.queue.front();
+                ctx.queue.pop_front();
+                lock.unlock();
+
+                try
+                {
+                    writeFunc(entry.index, *entry.image);
+                }
+                catch (const std::exception& e)
+                {
+                    m_stats.items[entry.index].ok = false;
+                    m_stats.items[entry.index].error = e.what();
+                }
+
+                // Let the worker continue
+                lock.lock();
+                ctx.pending[entry.workerIndex] = false;
+                ctx.cv.notify_all();
+            }
+
+            for (auto& w : workers)
+                threadJoin(w.get());
+
+            // Failed items
+            uint32_t numFailed = 0;
+            for (const auto& item : m_stats.items)
+                if (!item.ok)
+                    numFailed++;
+
+            if (numFailed > 0)
+                throw std::exception(strFormat("%u of %u apertures failed.", numFailed, numItems).c_str());
+        }
+        catch (const std::exception& e)
+        {
+            m_status.setError(e.what());
+        }
+    }
+
+    const BaseStatus& DiffractionBatch::getStatus() const
+    {
+        return m_status;
+    }
+
+    const DiffractionBatchStats& DiffractionBatch::getStats() const
+    {
+        return m_stats;
+    }
+
+}
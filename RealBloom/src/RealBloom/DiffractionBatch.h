@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+#include <cstdint>
+
+#include "Diffraction.h"
+
+#include "../ColorManagement/CmImage.h"
+
+#include "../Utils/ImageTransform.h"
+#include "../Utils/Status.h"
+#include "../Utils/Misc.h"
+
+namespace RealBloom
+{
+
+    struct DiffractionBatchParams
+    {
+        // Spectral diffraction is not supported in batches
+        DiffractionParams diffParams;
+
+        uint32_t numThreads = getMaxNumThreads();
+
+        // Upper limit for the memory used by the workers in bytes, this
+        // decides how many apertures are processed at the same time.
+        uint64_t memoryBudget = 2048ull * 1024ull * 1024ull;
+    };
+
+    struct DiffractionBatchItem
+    {
+        bool ok = true;
+        std::string error = "";
+        float elapsedMs = 0.0f;
+    };
+
+    struct DiffractionBatchStats
+    {
+        uint32_t numWorkers = 0;
+        uint32_t threadsPerWorker = 0;
+        uint64_t memoryPerWorker = 0;
+        std::vector<DiffractionBatchItem> items;
+    };
+
+    // Reads the aperture for an item into the image, called from the
+    // worker threads.
+    typedef std::function<void(uint32_t index, CmImage& target)> DiffBatchReadFunc;
+
+    // Receives the diffraction pattern for an item, called from the thread
+    // that called compute(), one item at a time.
+    typedef std::function<void(uint32_t index, CmImage& result)> DiffBatchWriteFunc;
+
+    // Diffraction for a list of apertures with the same dimensions.
+    // Each worker keeps its FFT buffers between the apertures, and the FFT
+    // plans are cached by pocketfft.
+    class DiffractionBatch
+    {
+    public:
+        DiffractionBatch();
+        DiffractionBatchParams* getParams();
+
+        void compute(uint32_t numItems, DiffBatchReadFunc readFunc, DiffBatchWriteFunc writeFunc);
+
+        const BaseStatus& getStatus() const;
+        const DiffractionBatchStats& getStats() const;
+
+    private:
+        BaseStatus m_status;
+        DiffractionBatchParams m_params;
+        DiffractionBatchStats m_stats;
+
+    };
+
+}
@@ -0,0 +1,253 @@
+#include "DiffractionFFT.h"
+
+#include <omp.h>
+
+namespace RealBloom
+{
+
+    static constexpr double LOG_CONTRAST_CONSTANT = 0.0002187;
+
+    template <typename T>
+    DiffractionFFT<T>::DiffractionFFT(uint32_t numThreads)
+        : m_numThreads((numThreads > 0) ? numThreads : getMaxNumThreads())
+    {}
+
+    template <typename T>
+    void DiffractionFFT<T>::setInput(
+        const float* inputBuffer, uint32_t inputWidth, uint32_t inputHeight,
+        bool grayscale, bool fastSize, bool resample)
+    {
+        m_numChannels = grayscale ? 1 : 3;
+
+        // Odd dimensions so that the shifted spectrum has an exact center
+        uint32_t oddWidth = (inputWidth % 2 == 0) ? (inputWidth + 1) : (inputWidth);
+        uint32_t oddHeight = (inputHeight % 2 == 0) ? (inputHeight + 1) : (inputHeight);
+
+        m_fftWidth = calcFftSize(inputWidth, fastSize);
+        m_fftHeight = calcFftSize(inputHeight, fastSize);
+
+        // If the FFT size is even, the last frequency (Nyquist) is left out
+        // to keep the center exact.
+        m_centeredWidth = (m_fftWidth % 2 == 0) ? (m_fftWidth - 1) : (m_fftWidth);
+        m_centeredHeight = (m_fftHeight % 2 == 0) ? (m_fftHeight - 1) : (m_fftHeight);
+
+        // Padding samples the spectrum more densely, which scales up the
+        // pattern. Resampling brings it back to the size we'd get without
+        // padding.
+        m_outputWidth = resample ? oddWidth : m_centeredWidth;
+        m_outputHeight = resample ? oddHeight : m_centeredHeight;
+        m_resample = resample;
+
+        // The input buffer is shared between the channels, the padding stays zero
+        m_input.resize(m_fftWidth, m_fftHeight, 1);
+
+        const uint32_t halfHeight = m_fftHeight / 2 + 1;
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            if (i < m_numChannels)
+                m_spectrum[i].resize(halfHeight, m_fftWidth);
+            else
+                m_spectrum[i].reset();
+        }
+
+        m_inputBuffer = inputBuffer;
+        m_inputWidth = inputWidth;
+        m_inputHeight = inputHeight;
+    }
+
+    template <typename T>
+    void DiffractionFFT<T>::transform()
+    {
+        // Real-to-complex FFT over both axes, the second axis (Y) gets halved
+        pocketfft::shape_t shape{ m_fftWidth, m_fftHeight };
+        pocketfft::stride_t strideIn{ sizeof(T), (ptrdiff_t)(m_input.getStride() * sizeof(T)) };
+        pocketfft::stride_t strideOut{ sizeof(std::complex<T>), (ptrdiff_t)(m_fftWidth * sizeof(std::complex<T>)) };
+
+        for (uint32_t i = 0; i < m_numChannels; i++)
+        {
+            m_input.deinterleave(m_inputBuffer, m_inputWidth, m_inputHeight, i);
+
+            pocketfft::r2c(
+                shape,
+                strideIn,
+                strideOut,
+                { 0, 1 },
+                pocketfft::FORWARD,
+                m_input.getPlane(0),
+                m_spectrum[i].getVector().data(),
+                (T)1,
+                m_numThreads);
+        }
+    }
+
+    template <typename T>
+    void DiffractionFFT<T>::findMaxMag()
+    {
+        // Since the spectrum is Hermitian, the half-spectrum contains every
+        // magnitude. Only the centered region is scanned, the Nyquist row
+        // and column are left out of the output too. Each thread keeps its
+        // own maximum, and they're merged at the end, so there's no locking
+        // inside the loop.
+
+        const int halfHeight = (int)(m_centeredHeight / 2 + 1);
+        const uint32_t nyquistX = (m_fftWidth % 2 == 0) ? (m_fftWidth / 2) : m_fftWidth;
+        T maxMag = (T)EPSILON;
+
+#pragma omp parallel num_threads(m_numThreads)
+        {
+            T threadMax = (T)EPSILON;
+
+#pragma omp for
+            for (int y = 0; y < halfHeight; y++)
+            {
+                for (uint32_t i = 0; i < m_numChannels; i++)
+                {
+                    const std::complex<T>* row = &(m_spectrum[i](y, 0));
+                    for (uint32_t x = 0; x < m_fftWidth; x++)
+                    {
+                        if (x == nyquistX)
+                            continue;
+
+                        T mag = getMagnitude(row[x]);
+                        if (mag > threadMax)
+                            threadMax = mag;
+                    }
+                }
+            }
+
+#pragma omp critical
+            {
+                if (threadMax > maxMag)
+                    maxMag = threadMax;
+            }
+        }
+
+        m_maxMag = maxMag;
+    }
+
+    template <typename T>
+    void DiffractionFFT<T>::output(float* outputBuffer, bool logNorm)
+    {
+        const T maxMag = m_maxMag;
+        const T logOfMaxMag = log(LOG_CONTRAST_CONSTANT * maxMag + 1.0);
+
+        // Without resampling, the output is the centered bins as they are
+        const bool resampling = m_resample && ((m_fftWidth != m_outputWidth) || (m_fftHeight != m_outputHeight));
+        const float scaleX = (float)m_fftWidth / (float)m_outputWidth;
+        const float scaleY = (float)m_fftHeight / (float)m_outputHeight;
+
+        const int halfWidth = (int)m_outputWidth / 2;
+        const int halfHeight = (int)m_outputHeight / 2;
+
+#pragma omp parallel for num_threads(m_numThreads)
+        for (int y = 0; y < (int)m_outputHeight; y++)
+        {
+            for (int x = 0; x < (int)m_outputWidth; x++)
+            {
+                uint32_t redIndex = (y * m_outputWidth + x) * 4;
+                for (uint32_t i = 0; i < 3; i++)
+                {
+                    if (i < m_numChannels)
+                    {
+                        T mag = resampling ?
+                            getMagBilinear(i, (float)(x - halfWidth) * scaleX, (float)(y - halfHeight) * scaleY)
+                            : getMag(i, x - halfWidth, y - halfHeight);
+
+                        outputBuffer[redIndex + i] = logNorm ?
+                            (float)(log(LOG_CONTRAST_CONSTANT * mag + 1.0) / logOfMaxMag)
+                            : (float)(mag / maxMag);
+                    }
+                    else
+                    {
+                        outputBuffer[redIndex + i] = outputBuffer[redIndex];
+                    }
+                }
+                outputBuffer[redIndex + 3] = 1.0f;
+            }
+        }
+    }
+
+    template <typename T>
+    uint64_t DiffractionFFT<T>::estimateMemory(uint32_t inputWidth, uint32_t inputHeight, bool grayscale, bool fastSize)
+    {
+        uint64_t fftWidth = calcFftSize(inputWidth, fastSize);
+        uint64_t fftHeight = calcFftSize(inputHeight, fastSize);
+        uint64_t numChannels = grayscale ? 1 : 3;
+
+        uint64_t inputSize = (uint64_t)PlanarImage<T>::calcStride((uint32_t)fftWidth) * fftHeight * sizeof(T);
+        uint64_t spectrumSize = fftWidth * (fftHeight / 2 + 1) * sizeof(std::complex<T>) * numChannels;
+
+        return inputSize + spectrumSize;
+    }
+
+    template <typename T>
+    uint32_t DiffractionFFT<T>::getFftWidth() const
+    {
+        return m_fftWidth;
+    }
+
+    template <typename T>
+    uint32_t DiffractionFFT<T>::getFftHeight() const
+    {
+        return m_fftHeight;
+    }
+
+    template <typename T>
+    uint32_t DiffractionFFT<T>::getOutputWidth() const
+    {
+        return m_outputWidth;
+    }
+
+    template <typename T>
+    uint32_t DiffractionFFT<T>::getOutputHeight() const
+    {
+        return m_outputHeight;
+    }
+
+    template <typename T>
+    uint32_t DiffractionFFT<T>::calcFftSize(uint32_t inputSize, bool fastSize)
+    {
+        uint32_t oddSize = (inputSize % 2 == 0) ? (inputSize + 1) : (inputSize);
+
+        // Odd sizes often have large prime factors (1025 = 5 * 5 * 41), so
+        // we zero-pad to the nearest smooth size instead.
+        return fastSize ? upperSmoothNumber(oddSize) : oddSize;
+    }
+
+    template <typename T>
+    T DiffractionFFT<T>::getMag(uint32_t ch, int fx, int fy) const
+    {
+        // Frequency to FFT bin
+        int kx = fx % (int)m_fftWidth;
+        int ky = fy % (int)m_fftHeight;
+        if (kx < 0) kx += m_fftWidth;
+        if (ky < 0) ky += m_fftHeight;
+
+        // Only the non-negative Y frequencies are stored, the rest are
+        // conjugates of the mirrored frequencies and have the same magnitude.
+        if (ky > (int)(m_fftHeight / 2))
+        {
+            ky = m_fftHeight - ky;
+            kx = (kx == 0) ? 0 : (m_fftWidth - kx);
+        }
+
+        return getMagnitude(m_spectrum[ch](ky, kx));
+    }
+
+    template <typename T>
+    T DiffractionFFT<T>::getMagBilinear(uint32_t ch, float fx, float fy) const
+    {
+        int x0 = (int)floorf(fx);
+        int y0 = (int)floorf(fy);
+        T tx = fx - (float)x0;
+        T ty = fy - (float)y0;
+
+        T top = getMag(ch, x0, y0) * (1 - tx) + getMag(ch, x0 + 1, y0) * tx;
+        T bottom = getMag(ch, x0, y0 + 1) * (1 - tx) + getMag(ch, x0 + 1, y0 + 1) * tx;
+        return top * (1 - ty) + bottom * ty;
+    }
+
+    template class DiffractionFFT<float>;
+    template class DiffractionFFT<double>;
+
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vector>
+#include <complex>
+#include <cstdint>
+#include <cmath>
+
+#include "pocketfft/pocketfft_hdronly.h"
+
+#include "../Utils/Array2D.h"
+#include "../Utils/PlanarImage.h"
+#include "../Utils/NumberHelpers.h"
+#include "../Utils/Misc.h"
+
+namespace RealBloom
+{
+
+    // Diffraction engine: real-to-complex FFT that only keeps the half-spectrum
+    // and shifts it on the fly while writing the output.
+    // T is the precision used for the transform (float or double).
+    template <typename T>
+    class DiffractionFFT
+    {
+    public:
+        // numThreads = 0 uses all available threads
+        DiffractionFFT(uint32_t numThreads = 0);
+
+        // fastSize: Pad to the nearest 2-3-5-smooth size instead of the
+        // nearest odd size.
+        // resample: Resample the magnitude back to the input size when the
+        // FFT size is different.
+        void setInput(
+            const float* inputBuffer, uint32_t inputWidth, uint32_t inputHeight,
+            bool grayscale, bool fastSize = true, bool resample = true);
+
+        void transform();
+        void findMaxMag();
+        void output(float* outputBuffer, bool logNorm);
+
+        // Estimated memory usage of the buffers in bytes
+        static uint64_t estimateMemory(uint32_t inputWidth, uint32_t inputHeight, bool grayscale, bool fastSize = true);
+
+        uint32_t getFftWidth() const;
+        uint32_t getFftHeight() const;
+        uint32_t getOutputWidth() const;
+        uint32_t getOutputHeight() const;
+
+    private:
+        uint32_t m_numThreads;
+        uint32_t m_numChannels = 3;
+
+        const float* m_inputBuffer = nullptr;
+        uint32_t m_inputWidth = 0;
+        uint32_t m_inputHeight = 0;
+
+        uint32_t m_fftWidth = 0;
+        uint32_t m_fftHeight = 0;
+
+        // Odd sizes centered on DC that fit in the FFT grid
+        uint32_t m_centeredWidth = 0;
+        uint32_t m_centeredHeight = 0;
+
+        uint32_t m_outputWidth = 0;
+        uint32_t m_outputHeight = 0;
+        bool m_resample = true;
+
+        // fftWidth x fftHeight, one plane shared between the channels
+        PlanarImage<T> m_input;
+
+        // Rows: (fftHeight / 2 + 1), Columns: fftWidth
+        Array2D<std::complex<T>> m_spectrum[3];
+
+        T m_maxMag = 0;
+
+        static uint32_t calcFftSize(uint32_t inputSize, bool fastSize);
+
+        T getMag(uint32_t ch, int fx, int fy) const;
+        T getMagBilinear(uint32_t ch, float fx, float fy) const;
+
+    };
+
+}
@@ -0,0 +1,195 @@
+#include "DiffractionSpectral.h"
+
+#include <omp.h>
+
+namespace RealBloom
+{
+
+    static constexpr double LOG_CONTRAST_CONSTANT = 0.0002187;
+
+    DiffractionSpectral::DiffractionSpectral(uint32_t numThreads)
+        : m_numThreads((numThreads > 0) ? numThreads : getMaxNumThreads())
+    {}
+
+    void DiffractionSpectral::setInput(const float* inputBuffer, uint32_t inputWidth, uint32_t inputHeight)
+    {
+        // Odd dimensions so that the output has an exact center
+        m_outputWidth = (inputWidth % 2 == 0) ? (inputWidth + 1) : (inputWidth);
+        m_outputHeight = (inputHeight % 2 == 0) ? (inputHeight + 1) : (inputHeight);
+
+        // Bounding box of the non-zero pixels
+        int minX = inputWidth, minY = inputHeight, maxX = -1, maxY = -1;
+        for (int y = 0; y < (int)inputHeight; y++)
+        {
+            for (int x = 0; x < (int)inputWidth; x++)
+            {
+                uint32_t redIndex = (y * inputWidth + x) * 4;
+                if ((inputBuffer[redIndex + 0] != 0.0f) || (inputBuffer[redIndex + 1] != 0.0f) || (inputBuffer[redIndex + 2] != 0.0f))
+                {
+                    minX = std::min(minX, x);
+                    minY = std::min(minY, y);
+                    maxX = std::max(maxX, x);
+                    maxY = std::max(maxY, y);
+                }
+            }
+        }
+
+        if (maxX < 0)
+            throw std::exception("The aperture is empty.");
+
+        m_apertureWidth = maxX - minX + 1;
+        m_apertureHeight = maxY - minY + 1;
+        m_aperture.resize(m_apertureWidth * m_apertureHeight);
+
+        // The largest magnitude is at DC when the aperture is non-negative,
+        // this is the upper bound in general.
+        double sumAbs = 0.0;
+        for (uint32_t y = 0; y < m_apertureHeight; y++)
+        {
+            for (uint32_t x = 0; x < m_apertureWidth; x++)
+            {
+                uint32_t redIndex = ((y + minY) * inputWidth + (x + minX)) * 4;
+                float v = (inputBuffer[redIndex + 0] + inputBuffer[redIndex + 1] + inputBuffer[redIndex + 2]) / 3.0f;
+                m_aperture[y * m_apertureWidth + x] = v;
+                sumAbs += fabs(v);
+            }
+        }
+        m_maxMag = std::max(sumAbs, (double)EPSILON);
+    }
+
+    void DiffractionSpectral::compute(const std::vector<float>& cmfSamples, uint32_t steps, float amount, float edgeOffset, bool logNorm)
+    {
+        if (cmfSamples.size() < (steps * 3))
+            throw std::exception("Invalid number of CMF samples.");
+
+        amount = fmaxf(amount, 0.0f);
+        edgeOffset = std::clamp(edgeOffset, -1.0f, 1.0f);
+
+        const uint32_t centerX = m_outputWidth / 2;
+        const uint32_t centerY = m_outputHeight / 2;
+        const uint32_t numRows = centerY + 1;
+
+        const double logOfMaxMag = log(LOG_CONTRAST_CONSTANT * m_maxMag + 1.0);
+
+        m_sum.resize(numRows * m_outputWidth * 3);
+        std::fill(m_sum.begin(), m_sum.end(), 0.0f);
+
+        // Rows of the aperture transformed along X
+        std::vector<std::complex<float>> rowFT(m_apertureHeight * m_outputWidth);
+
+        for (uint32_t i = 0; i < steps; i++)
+        {
+            float scale, areaMul;
+            calcDispScale(i, steps, amount, edgeOffset, scale, areaMul);
+
+            float wlR = cmfSamples[i * 3 + 0] * areaMul;
+            float wlG = cmfSamples[i * 3 + 1] * areaMul;
+            float wlB = cmfSamples[i * 3 + 2] * areaMul;
+
+            // Without padding, the output pixel at offset d from the center
+            // samples the frequency d / size. Scaling the pattern up divides
+            // the frequencies by the scale.
+            double dfx = 1.0 / ((double)m_outputWidth * (double)scale);
+            double dfy = 1.0 / ((double)m_outputHeight * (double)scale);
+
+            ChirpZ czX(m_apertureWidth, m_outputWidth, -(double)centerX * dfx, dfx);
+            ChirpZ czY(m_apertureHeight, numRows, 0.0, dfy);
+
+            m_convWidth = czX.getConvSize();
+            m_convHeight = czY.getConvSize();
+
+#pragma omp parallel num_threads(m_numThreads)
+            {
+                std::vector<std::complex<float>> scratch;
+
+#pragma omp for
+                for (int y = 0; y < (int)m_apertureHeight; y++)
+                {
+                    czX.apply(
+                        &(m_aperture[y * m_apertureWidth]), 1,
+                        &(rowFT[y * m_outputWidth]), 1,
+                        scratch);
+                }
+            }
+
+#pragma omp parallel num_threads(m_numThreads)
+            {
+                std::vector<std::complex<float>> scratch;
+                std::vector<std::complex<float>> colFT(numRows);
+
+                // Every column is written by a single thread
+#pragma omp for
+                for (int x = 0; x < (int)m_outputWidth; x++)
+                {
+                    czY.apply(
+                        &(rowFT[x]), m_outputWidth,
+                        colFT.data(), 1,
+                        scratch);
+
+                    for (uint32_t y = 0; y < numRows; y++)
+                    {
+                        double mag = getMagnitude(colFT[y]);
+                        float v = logNorm ?
+                            (float)(log(LOG_CONTRAST_CONSTANT * mag + 1.0) / logOfMaxMag)
+                            : (float)(mag / m_maxMag);
+
+                        uint32_t redIndex = (y * m_outputWidth + x) * 3;
+                        m_sum[redIndex + 0] += v * wlR;
+                        m_sum[redIndex + 1] += v * wlG;
+                        m_sum[redIndex + 2] += v * wlB;
+                    }
+                }
+            }
+        }
+    }
+
+    void DiffractionSpectral::output(float* outputBuffer)
+    {
+        const int centerX = (int)m_outputWidth / 2;
+        const int centerY = (int)m_outputHeight / 2;
+
+#pragma omp parallel for num_threads(m_numThreads)
+        for (int y = 0; y < (int)m_outputHeight; y++)
+        {
+            for (int x = 0; x < (int)m_outputWidth; x++)
+            {
+                // Mirror the top half around the center
+                int sumX = x;
+                int sumY = y - centerY;
+                if (sumY < 0)
+                {
+                    sumX = (int)m_outputWidth - 1 - x;
+                    sumY = -sumY;
+                }
+
+                uint32_t sumIndex = (sumY * m_outputWidth + sumX) * 3;
+                uint32_t redIndex = (y * m_outputWidth + x) * 4;
+                outputBuffer[redIndex + 0] = m_sum[sumIndex + 0];
+                outputBuffer[redIndex + 1] = m_sum[sumIndex + 1];
+                outputBuffer[redIndex + 2] = m_sum[sumIndex + 2];
+                outputBuffer[redIndex + 3] = 1.0f;
+            }
+        }
+    }
+
+    uint32_t DiffractionSpectral::getOutputWidth() const
+    {
+        return m_outputWidth;
+    }
+
+    uint32_t DiffractionSpectral::getOutputHeight() const
+    {
+        return m_outputHeight;
+    }
+
+    uint32_t DiffractionSpectral::getConvWidth() const
+    {
+        return m_convWidth;
+    }
+
+    uint32_t DiffractionSpectral::getConvHeight() const
+    {
+        return m_convHeight;
+    }
+
+}
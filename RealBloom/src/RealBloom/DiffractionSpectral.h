@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+#include <complex>
+#include <memory>
+#include <cstdint>
+#include <cmath>
+
+#include "../Utils/ChirpZ.h"
+#include "../Utils/NumberHelpers.h"
+#include "../Utils/Misc.h"
+
+namespace RealBloom
+{
+
+    // Spectral diffraction: the Fourier transform of the aperture is
+    // evaluated on a differently scaled frequency grid for every wavelength
+    // using the chirp-z transform, and the magnitudes are summed with the
+    // CMF weights. This gives the same result as diffraction followed by
+    // dispersion, without resampling a full-resolution image per step.
+    class DiffractionSpectral
+    {
+    public:
+        // numThreads = 0 uses all available threads
+        DiffractionSpectral(uint32_t numThreads = 0);
+
+        // The aperture is converted to grayscale (average) since it's used as
+        // the transmission for every wavelength.
+        void setInput(const float* inputBuffer, uint32_t inputWidth, uint32_t inputHeight);
+
+        // cmfSamples: RGB weights for each step (steps * 3)
+        void compute(const std::vector<float>& cmfSamples, uint32_t steps, float amount, float edgeOffset, bool logNorm);
+        void output(float* outputBuffer);
+
+        uint32_t getOutputWidth() const;
+        uint32_t getOutputHeight() const;
+
+        // Size of the FFTs used by the chirp-z transforms
+        uint32_t getConvWidth() const;
+        uint32_t getConvHeight() const;
+
+    private:
+        uint32_t m_numThreads;
+
+        // Grayscale aperture cropped to its non-zero area, as the magnitude
+        // doesn't depend on the position.
+        std::vector<float> m_aperture;
+        uint32_t m_apertureWidth = 0;
+        uint32_t m_apertureHeight = 0;
+        double m_maxMag = 0;
+
+        uint32_t m_outputWidth = 0;
+        uint32_t m_outputHeight = 0;
+        uint32_t m_convWidth = 0;
+        uint32_t m_convHeight = 0;
+
+        // RGB, only the rows from the center to the bottom are computed since
+        // the magnitude is symmetric around the center.
+        std::vector<float> m_sum;
+
+    };
+
+}
@@ -66,6 +66,7 @@ namespace RealBloom
             {
                 std::scoped_lock lock(*m_imgDisp);
                 m_imgDisp->resize(pWidth, pHeight, false);
+                m_imgDisp->setStorageFormat(CmPixelFormat::RGB32F, false);
                 float* imageBuffer = m_imgDisp->getImageData();
                 std::copy(buffer.data(), buffer.data() + buffer.size(), imageBuffer);
             }
@@ -77,9 +78,9 @@ namespace RealBloom
         }
     }
 
-    void Dispersion::previewInput(bool previewMode, std::vector<float>* outBuffer, uint32_t* outWidth, uint32_t* outHeight)
+    void Dispersion::previewInput(bool previewMode, CmSharedBuffer* outBuffer, uint32_t* outWidth, uint32_t* outHeight)
     {
-        processInputImage(previewMode, m_params.inputTransformParams, m_imgInputSrc, *m_imgInput, outBuffer, outWidth, outHeight);
+        processInputImage(previewMode, m_params.inputTransformParams, m_imgInputSrc, *m_imgInput, outBuffer, outWidth, outHeight, &m_inputTransformCache);
     }
 
     void Dispersion::compute()
@@ -117,7 +118,7 @@ namespace RealBloom
                         throw std::exception("An active CMF table is needed.");
 
                     // Input buffer
-                    std::vector<float> inputBuffer;
+                    CmSharedBuffer inputBuffer;
                     uint32_t inputWidth = 0, inputHeight = 0;
                     previewInput(false, &inputBuffer, &inputWidth, &inputHeight);
                     uint32_t inputBufferSize = inputWidth * inputHeight * 4;
@@ -133,12 +134,12 @@ namespace RealBloom
                     {
                     case RealBloom::DispersionMethod::CPU:
                         dispCPU(
-                            inputBuffer, inputWidth, inputHeight,
+                            *inputBuffer, inputWidth, inputHeight,
                             inputBufferSize, cmfSamples);
                         break;
                     case RealBloom::DispersionMethod::GPU:
                         dispGPU(
-                            inputBuffer, inputWidth, inputHeight,
+                            *inputBuffer, inputWidth, inputHeight,
                             inputBufferSize, cmfSamples);
                         break;
                     default:
@@ -247,7 +248,7 @@ namespace RealBloom
     }
 
     void Dispersion::dispCPU(
-        std::vector<float>& inputBuffer,
+        const FloatBuffer& inputBuffer,
         uint32_t inputWidth,
         uint32_t inputHeight,
         uint32_t inputBufferSize,
@@ -256,23 +257,22 @@ namespace RealBloom
         // Parameters
         uint32_t numThreads = m_capturedParams.methodInfo.numThreads;
 
+        // The threads work on RGB planes, outlives the threads
+        PlanarImage<float> inputPlanes;
+
         try
         {
+            inputPlanes.resize(inputWidth, inputHeight, 3);
+            inputPlanes.deinterleave(inputBuffer.data(), inputWidth, inputHeight);
+
             // Create and prepare threads
             for (uint32_t i = 0; i < numThreads; i++)
             {
                 std::shared_ptr<DispersionThread> ct = std::make_shared<DispersionThread>(
                     numThreads, i, m_capturedParams,
-                    inputBuffer.data(), inputWidth, inputHeight,
-                    cmfSamples.data()
+                    &inputPlanes, cmfSamples.data()
                     );
 
-                std::vector<float>& threadBuffer = ct->getOutputBuffer();
-
-                threadBuffer.resize(inputBufferSize);
-                for (uint32_t j = 0; j < inputBufferSize; j++)
-                    threadBuffer[j] = (j % 4 == 3) ? 1.0f : 0.0f;
-
                 m_threads.push_back(ct);
             }
 
@@ -308,34 +308,16 @@ namespace RealBloom
                     // Take a snapshot of the current progress
                     if ((!m_status.mustCancel()) && (numThreadsDone < numThreads) && ((numDone - lastNumDone) >= numThreads))
                     {
-                        std::vector<float> progBuffer;
-                        progBuffer.resize(inputBufferSize);
-                        for (uint32_t i = 0; i < inputBufferSize; i++)
-                            if (i % 4 == 3) progBuffer[i] = 1.0f;
-                            else progBuffer[i] = 0.0f;
-
+                        PlanarImage<float> progBuffer;
+                        progBuffer.resize(inputWidth, inputHeight, 3);
                         for (auto& ct : m_threads)
-                        {
-                            std::vector<float>& currentBuffer = ct->getOutputBuffer();
-                            uint32_t redIndex;
-                            for (uint32_t y = 0; y < inputHeight; y++)
-                            {
-                                for (uint32_t x = 0; x < inputWidth; x++)
-                                {
-                                    redIndex = (y * inputWidth + x) * 4;
-                                    progBuffer[redIndex + 0] += currentBuffer[redIndex + 0];
-                                    progBuffer[redIndex + 1] += currentBuffer[redIndex + 1];
-                                    progBuffer[redIndex + 2] += currentBuffer[redIndex + 2];
-                                }
-                            }
-                        }
+                            progBuffer.add(ct->getOutputBuffer());
 
                         // Copy progBuffer into the dispersion image
                         {
                             std::scoped_lock lock(*m_imgDisp);
                             m_imgDisp->resize(inputWidth, inputHeight, false);
-                            float* dispBuffer = m_imgDisp->getImageData();
-                            std::copy(progBuffer.data(), progBuffer.data() + inputBufferSize, dispBuffer);
+                            progBuffer.interleave(m_imgDisp->getImageData());
                         }
                         m_imgDisp->moveToGPU();
 
@@ -355,26 +337,15 @@ namespace RealBloom
 
             // Add the buffers from each thread
             {
+                PlanarImage<float> dispPlanes;
+                dispPlanes.resize(inputWidth, inputHeight, 3);
+                for (auto& ct : m_threads)
+                    dispPlanes.add(ct->getOutputBuffer());
+
                 std::scoped_lock lock(*m_imgDisp);
                 m_imgDisp->resize(inputWidth, inputHeight, false);
-                m_imgDisp->fill(std::array<float, 4>{ 0, 0, 0, 1 }, false);
-                float* dispBuffer = m_imgDisp->getImageData();
-
-                for (auto& ct : m_threads)
-                {
-                    std::vector<float>& threadBuffer = ct->getOutputBuffer();
-                    uint32_t redIndex;
-                    for (uint32_t y = 0; y < inputHeight; y++)
-                    {
-                        for (uint32_t x = 0; x < inputWidth; x++)
-                        {
-                            redIndex = (y * inputWidth + x) * 4;
-                            dispBuffer[redIndex + 0] += threadBuffer[redIndex + 0];
-                            dispBuffer[redIndex + 1] += threadBuffer[redIndex + 1];
-                            dispBuffer[redIndex + 2] += threadBuffer[redIndex + 2];
-                        }
-                    }
-                }
+                m_imgDisp->setStorageFormat(CmPixelFormat::RGB32F, false);
+                dispPlanes.interleave(m_imgDisp->getImageData());
             }
         }
         catch (const std::exception& e)
@@ -387,7 +358,7 @@ namespace RealBloom
     }
 
     void Dispersion::dispGPU(
-        std::vector<float>& inputBuffer,
+        const FloatBuffer& inputBuffer,
         uint32_t inputWidth,
         uint32_t inputHeight,
         uint32_t inputBufferSize,
@@ -407,7 +378,7 @@ namespace RealBloom
             binInput.dp_steps = m_capturedParams.steps;
             binInput.inputWidth = inputWidth;
             binInput.inputHeight = inputHeight;
-            binInput.inputBuffer = inputBuffer;
+            binInput.inputBuffer.assign(inputBuffer.begin(), inputBuffer.end());
             binInput.cmfSamples = cmfSamples;
 
             // Create the input file
@@ -462,6 +433,7 @@ namespace RealBloom
 
                 std::scoped_lock lock(*m_imgDisp);
                 m_imgDisp->resize(inputWidth, inputHeight, false);
+                m_imgDisp->setStorageFormat(CmPixelFormat::RGB32F, false);
                 float* dispBuffer = m_imgDisp->getImageData();
                 uint32_t dispBufferSize = m_imgDisp->getImageDataSize();
 
@@ -66,7 +66,7 @@ namespace RealBloom
         void setImgDisp(CmImage* image);
 
         void previewCmf(CmfTable* table);
-        void previewInput(bool previewMode = true, std::vector<float>* outBuffer = nullptr, uint32_t* outWidth = nullptr, uint32_t* outHeight = nullptr);
+        void previewInput(bool previewMode = true, CmSharedBuffer* outBuffer = nullptr, uint32_t* outWidth = nullptr, uint32_t* outHeight = nullptr);
         void compute();
         void cancel();
 
@@ -81,6 +81,7 @@ namespace RealBloom
 
         CmImage m_imgInputSrc;
         CmImage* m_imgInput = nullptr;
+        TransformCache m_inputTransformCache;
 
         CmImage* m_imgDisp = nullptr;
 
@@ -90,14 +91,14 @@ namespace RealBloom
 
     private:
         void dispCPU(
-            std::vector<float>& inputBuffer,
+            const FloatBuffer& inputBuffer,
             uint32_t inputWidth,
             uint32_t inputHeight,
             uint32_t inputBufferSize,
             std::vector<float>& cmfSamples);
 
         void dispGPU(
-            std::vector<float>& inputBuffer,
+            const FloatBuffer& inputBuffer,
             uint32_t inputWidth,
             uint32_t inputHeight,
             uint32_t inputBufferSize,
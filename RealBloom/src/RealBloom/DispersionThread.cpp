@@ -5,12 +5,13 @@ namespace RealBloom
 
     DispersionThread::DispersionThread(
         uint32_t numThreads, uint32_t threadIndex, const DispersionParams& params,
-        float* inputBuffer, uint32_t inputWidth, uint32_t inputHeight,
-        float* cmfSamples)
+        const PlanarImage<float>* input, float* cmfSamples)
         : m_numThreads(numThreads), m_threadIndex(threadIndex), m_params(params),
-        m_inputBuffer(inputBuffer), m_inputWidth(inputWidth), m_inputHeight(inputHeight),
+        m_input(input), m_inputWidth(input->getWidth()), m_inputHeight(input->getHeight()),
         m_cmfSamples(cmfSamples)
-    {}
+    {
+        m_outputBuffer.resize(m_inputWidth, m_inputHeight, 3);
+    }
 
     void DispersionThread::start()
     {
@@ -36,11 +37,6 @@ namespace RealBloom
         float centerX = (float)m_inputWidth / 2.0f;
         float centerY = (float)m_inputHeight / 2.0f;
 
-        // Scaled buffer for individual steps
-        uint32_t scaledBufferSize = m_inputWidth * m_inputHeight * 3;
-        std::vector<float> scaledBuffer;
-        scaledBuffer.resize(scaledBufferSize);
-
         // Start
 
         m_state.state = DispersionThreadState::Working;
@@ -61,27 +57,22 @@ namespace RealBloom
 
             // Wavelength to RGB
             uint32_t smpIndex = i * 3;
-            float wlR = m_cmfSamples[smpIndex + 0] * areaMul;
-            float wlG = m_cmfSamples[smpIndex + 1] * areaMul;
-            float wlB = m_cmfSamples[smpIndex + 2] * areaMul;
+            float wl[3];
+            wl[0] = m_cmfSamples[smpIndex + 0] * areaMul;
+            wl[1] = m_cmfSamples[smpIndex + 1] * areaMul;
+            wl[2] = m_cmfSamples[smpIndex + 2] * areaMul;
 
-            // Clear scaledBuffer
-            for (auto& v : scaledBuffer)
-                v = 0.0f;
-
-            // Scale
+            // Scale, colorize and add to the output
             if (areEqual(scale, 1))
             {
-                for (int y = 0; y < m_inputHeight; y++)
+                for (uint32_t ch = 0; ch < 3; ch++)
                 {
-                    for (int x = 0; x < m_inputWidth; x++)
+                    for (uint32_t y = 0; y < m_inputHeight; y++)
                     {
-                        uint32_t redIndexDP = (y * m_inputWidth + x) * 4;
-                        uint32_t redIndexScaled = (y * m_inputWidth + x) * 3;
-
-                        scaledBuffer[redIndexScaled + 0] = m_inputBuffer[redIndexDP + 0];
-                        scaledBuffer[redIndexScaled + 1] = m_inputBuffer[redIndexDP + 1];
-                        scaledBuffer[redIndexScaled + 2] = m_inputBuffer[redIndexDP + 2];
+                        const float* inputRow = m_input->getRow(ch, y);
+                        float* outputRow = m_outputBuffer.getRow(ch, y);
+                        for (uint32_t x = 0; x < m_inputWidth; x++)
+                            outputRow[x] += inputRow[x] * wl[ch];
                     }
                 }
             }
@@ -102,61 +93,40 @@ namespace RealBloom
                         targetColor[1] = 0;
                         targetColor[2] = 0;
 
-                        int redIndexBuffer;
-
                         if (checkBounds(bil.topLeftPos[0], bil.topLeftPos[1], m_inputWidth, m_inputHeight))
-                        {
-                            redIndexBuffer = (bil.topLeftPos[1] * m_inputWidth + bil.topLeftPos[0]) * 4;
-                            blendAddRGB(targetColor, 0, m_inputBuffer, redIndexBuffer, bil.topLeftWeight);
-                        }
+                            blendAddPlanes(targetColor, bil.topLeftPos[0], bil.topLeftPos[1], bil.topLeftWeight);
                         if (checkBounds(bil.topRightPos[0], bil.topRightPos[1], m_inputWidth, m_inputHeight))
-                        {
-                            redIndexBuffer = (bil.topRightPos[1] * m_inputWidth + bil.topRightPos[0]) * 4;
-                            blendAddRGB(targetColor, 0, m_inputBuffer, redIndexBuffer, bil.topRightWeight);
-                        }
+                            blendAddPlanes(targetColor, bil.topRightPos[0], bil.topRightPos[1], bil.topRightWeight);
                         if (checkBounds(bil.bottomLeftPos[0], bil.bottomLeftPos[1], m_inputWidth, m_inputHeight))
-                        {
-                            redIndexBuffer = (bil.bottomLeftPos[1] * m_inputWidth + bil.bottomLeftPos[0]) * 4;
-                            blendAddRGB(targetColor, 0, m_inputBuffer, redIndexBuffer, bil.bottomLeftWeight);
-                        }
+                            blendAddPlanes(targetColor, bil.bottomLeftPos[0], bil.bottomLeftPos[1], bil.bottomLeftWeight);
                         if (checkBounds(bil.bottomRightPos[0], bil.bottomRightPos[1], m_inputWidth, m_inputHeight))
-                        {
-                            redIndexBuffer = (bil.bottomRightPos[1] * m_inputWidth + bil.bottomRightPos[0]) * 4;
-                            blendAddRGB(targetColor, 0, m_inputBuffer, redIndexBuffer, bil.bottomRightWeight);
-                        }
+                            blendAddPlanes(targetColor, bil.bottomRightPos[0], bil.bottomRightPos[1], bil.bottomRightWeight);
 
-                        int redIndexScaled = (y * m_inputWidth + x) * 3;
-                        std::copy(targetColor, targetColor + 3, &(scaledBuffer[redIndexScaled]));
+                        for (uint32_t ch = 0; ch < 3; ch++)
+                            m_outputBuffer(ch, y, x) += targetColor[ch] * wl[ch];
                     }
                 }
             }
 
-            // Colorize and add to dispBuffer
-            for (int y = 0; y < m_inputHeight; y++)
-            {
-                for (int x = 0; x < m_inputWidth; x++)
-                {
-                    uint32_t redIndexScaled = (y * m_inputWidth + x) * 3;
-                    uint32_t redIndexOutput = (y * m_inputWidth + x) * 4;
-
-                    m_outputBuffer[redIndexOutput + 0] += scaledBuffer[redIndexScaled + 0] * wlR;
-                    m_outputBuffer[redIndexOutput + 1] += scaledBuffer[redIndexScaled + 1] * wlG;
-                    m_outputBuffer[redIndexOutput + 2] += scaledBuffer[redIndexScaled + 2] * wlB;
-                }
-            }
-
             m_state.numDone++;
         }
 
         m_state.state = DispersionThreadState::Done;
     }
 
+    void DispersionThread::blendAddPlanes(float* color, int x, int y, float t) const
+    {
+        color[0] += (*m_input)(0, y, x) * t;
+        color[1] += (*m_input)(1, y, x) * t;
+        color[2] += (*m_input)(2, y, x) * t;
+    }
+
     void DispersionThread::stop()
     {
         m_mustStop = true;
     }
 
-    std::vector<float>& DispersionThread::getOutputBuffer()
+    PlanarImage<float>& DispersionThread::getOutputBuffer()
     {
         return m_outputBuffer;
     }
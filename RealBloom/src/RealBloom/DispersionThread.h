@@ -7,6 +7,7 @@
 #include <cstdint>
 
 #include "Dispersion.h"
+#include "../Utils/PlanarImage.h"
 #include "../Utils/NumberHelpers.h"
 
 namespace RealBloom
@@ -33,13 +34,13 @@ namespace RealBloom
     public:
         DispersionThread(
             uint32_t numThreads, uint32_t threadIndex, const DispersionParams& params,
-            float* inputBuffer, uint32_t inputWidth, uint32_t inputHeight,
-            float* cmfSamples);
+            const PlanarImage<float>* input, float* cmfSamples);
 
         void start();
         void stop();
 
-        std::vector<float>& getOutputBuffer();
+        // RGB planes, zeroed when the thread is created
+        PlanarImage<float>& getOutputBuffer();
         std::shared_ptr<std::jthread> getThread();
         void setThread(std::shared_ptr<std::jthread> thread);
 
@@ -55,13 +56,16 @@ namespace RealBloom
 
         DispersionParams m_params;
 
-        float* m_inputBuffer;
+        // RGB planes
+        const PlanarImage<float>* m_input;
         uint32_t m_inputWidth;
         uint32_t m_inputHeight;
 
         float* m_cmfSamples;
 
-        std::vector<float> m_outputBuffer;
+        PlanarImage<float> m_outputBuffer;
+
+        void blendAddPlanes(float* color, int x, int y, float t) const;
 
     };
 
@@ -0,0 +1,256 @@
+#include "KernelBuilder.h"
+
+namespace RealBloom
+{
+
+    static constexpr uint32_t KB_WAIT_TIMESTEP = 5;
+
+    // Global state that wavelengths are converted with
+    static void hashSpectralState(Hasher& hasher)
+    {
+        const CmfTableInfo& tableInfo = CMF::getActiveTableInfo();
+        XyzConversionInfo xyzInfo = CmXYZ::getConversionInfo();
+        hasher.add(tableInfo.name).add(tableInfo.path);
+        hasher.add(xyzInfo.method).add(xyzInfo.userSpace).add(xyzInfo.commonInternal).add(xyzInfo.commonUser);
+        hasher.add(CMS::getWorkingSpace());
+    }
+
+    KernelBuilder::KernelBuilder()
+        : m_imgDiffInput("kbDiffInput", "Kernel Builder Diffraction Input"),
+        m_imgDiffOutput("kbDiffOutput", "Kernel Builder Diffraction Output"),
+        m_imgDispInput("kbDispInput", "Kernel Builder Dispersion Input"),
+        m_imgDispOutput("kbDispOutput", "Kernel Builder Dispersion Output")
+    {
+        m_diff.setImgInput(&m_imgDiffInput);
+        m_diff.setImgDiff(&m_imgDiffOutput);
+
+        m_disp.setImgInput(&m_imgDispInput);
+        m_disp.setImgDisp(&m_imgDispOutput);
+    }
+
+    KernelBuilderParams* KernelBuilder::getParams()
+    {
+        return &m_params;
+    }
+
+    CmImage* KernelBuilder::getImgApertureSrc()
+    {
+        // The aperture goes straight into the diffraction module
+        return m_diff.getImgInputSrc();
+    }
+
+    void KernelBuilder::setImgKernel(CmImage* image)
+    {
+        m_imgKernel = image;
+    }
+
+    void KernelBuilder::build(std::function<bool()> mustCancel)
+    {
+        m_status.reset();
+        m_stats = KernelBuilderStats();
+
+        try
+        {
+            std::chrono::system_clock::time_point startTime = std::chrono::system_clock::now();
+            uint64_t apertureKey = hashAperture();
+            m_stats.timings.push_back({ "Hash", getElapsedMs(startTime) });
+
+            // Diffraction
+            uint64_t diffKey = hashDiffraction(apertureKey);
+            std::shared_ptr<CacheEntry> diffEntry = cacheFind(diffKey);
+            m_stats.diffCached = (diffEntry.get() != nullptr);
+            if (!diffEntry)
+            {
+                startTime = std::chrono::system_clock::now();
+                *(m_diff.getParams()) = m_params.diffParams;
+                m_diff.compute();
+                if (!m_diff.getStatus().isOK())
+                    throw std::exception(m_diff.getStatus().getError().c_str());
+
+                diffEntry = cacheInsert(diffKey, m_imgDiffOutput);
+                m_stats.timings.push_back({ "Diffraction", getElapsedMs(startTime) });
+            }
+
+            // Dispersion
+            std::shared_ptr<CacheEntry> kernelEntry = diffEntry;
+            if (m_params.useDispersion)
+            {
+                uint64_t dispKey = hashDispersion(diffKey);
+                kernelEntry = cacheFind(dispKey);
+                m_stats.dispCached = (kernelEntry.get() != nullptr);
+                if (!kernelEntry)
+                {
+                    startTime = std::chrono::system_clock::now();
+
+                    // The diffraction pattern stays in the cache
+                    {
+                        CmImage* dispInput = m_disp.getImgInputSrc();
+                        std::scoped_lock lock(*dispInput);
+                        dispInput->setImageData(diffEntry->buffer, diffEntry->width, diffEntry->height);
+                    }
+                    m_disp.getImgInputSrc()->moveToGPU();
+
+                    *(m_disp.getParams()) = m_params.dispParams;
+                    m_disp.compute();
+
+                    while (m_disp.getStatus().isWorking())
+                    {
+                        if (mustCancel && mustCancel())
+                        {
+                            m_disp.cancel();
+                            throw std::exception("Canceled.");
+                        }
+                        std::this_thread::sleep_for(std::chrono::milliseconds(KB_WAIT_TIMESTEP));
+                    }
+
+                    if (!m_disp.getStatus().isOK())
+                        throw std::exception(m_disp.getStatus().getError().c_str());
+
+                    kernelEntry = cacheInsert(dispKey, m_imgDispOutput);
+                    m_stats.timings.push_back({ "Dispersion", getElapsedMs(startTime) });
+                }
+            }
+
+            m_kernel = kernelEntry;
+
+            // Update the kernel image
+            if (m_imgKernel)
+            {
+                {
+                    std::scoped_lock lock(*m_imgKernel);
+                    m_imgKernel->setImageData(m_kernel->buffer, m_kernel->width, m_kernel->height);
+                }
+                m_imgKernel->setSourceName(getImgApertureSrc()->getSourceName());
+                m_imgKernel->moveToGPU();
+            }
+        }
+        catch (const std::exception& e)
+        {
+            m_status.setError(e.what());
+        }
+    }
+
+    bool KernelBuilder::applyTo(Convolution& conv)
+    {
+        if (!m_kernel)
+            return false;
+
+        // Something else might have been read into the kernel source
+        CmImage* kernelSrc = conv.getImgKernelSrc();
+        if ((m_appliedConv == &conv) && (m_appliedKey == m_kernel->key) && (m_appliedGeneration == kernelSrc->getGeneration()))
+            return false;
+
+        {
+            std::scoped_lock lock(*kernelSrc);
+            kernelSrc->setImageData(m_kernel->buffer, m_kernel->width, m_kernel->height);
+        }
+        kernelSrc->setSourceName(getImgApertureSrc()->getSourceName());
+        kernelSrc->moveToGPU();
+
+        m_appliedConv = &conv;
+        m_appliedKey = m_kernel->key;
+        m_appliedGeneration = kernelSrc->getGeneration();
+        return true;
+    }
+
+    uint64_t KernelBuilder::getKernelKey() const
+    {
+        return m_kernel ? m_kernel->key : 0;
+    }
+
+    void KernelBuilder::clearCache()
+    {
+        m_cache.clear();
+    }
+
+    const BaseStatus& KernelBuilder::getStatus() const
+    {
+        return m_status;
+    }
+
+    const KernelBuilderStats& KernelBuilder::getStats() const
+    {
+        return m_stats;
+    }
+
+    std::shared_ptr<KernelBuilder::CacheEntry> KernelBuilder::cacheFind(uint64_t key)
+    {
+        for (auto it = m_cache.begin(); it != m_cache.end(); it++)
+        {
+            if ((*it)->key == key)
+            {
+                // Move to the front
+                std::shared_ptr<CacheEntry> entry = *it;
+                m_cache.erase(it);
+                m_cache.push_front(entry);
+                return entry;
+            }
+        }
+        return nullptr;
+    }
+
+    std::shared_ptr<KernelBuilder::CacheEntry> KernelBuilder::cacheInsert(uint64_t key, CmImage& image)
+    {
+        std::shared_ptr<CacheEntry> entry = std::make_shared<CacheEntry>();
+        entry->key = key;
+
+        // Take the buffer instead of copying it, the image lets go of it so
+        // that the next output doesn't need to detach from it
+        {
+            std::scoped_lock lock(image);
+            entry->width = image.getWidth();
+            entry->height = image.getHeight();
+            entry->buffer = image.shareImageData();
+            image.reset(false);
+        }
+
+        m_cache.push_front(entry);
+        while (m_cache.size() > KB_CACHE_CAPACITY)
+            m_cache.pop_back();
+
+        return entry;
+    }
+
+    uint64_t KernelBuilder::hashAperture()
+    {
+        // Cached by the image until it changes
+        CmImage* aperture = getImgApertureSrc();
+        std::shared_lock lock(*aperture);
+        return aperture->getContentHash();
+    }
+
+    uint64_t KernelBuilder::hashDiffraction(uint64_t apertureKey)
+    {
+        const DiffractionParams& params = m_params.diffParams;
+
+        Hasher hasher;
+        hasher.add(apertureKey);
+        params.inputTransformParams.hash(hasher);
+        hasher.add(params.logNorm).add(params.doublePrecision).add(params.fastSize).add(params.resample);
+        hasher.add(params.spectral);
+
+        // Spectral diffraction also depends on the CMF table
+        if (params.spectral)
+        {
+            hasher.add(params.spectralAmount).add(params.spectralEdgeOffset).add(params.spectralSteps);
+            hashSpectralState(hasher);
+        }
+
+        return hasher.get();
+    }
+
+    uint64_t KernelBuilder::hashDispersion(uint64_t diffKey)
+    {
+        const DispersionParams& params = m_params.dispParams;
+
+        // The method doesn't change the result
+        Hasher hasher;
+        hasher.add(diffKey);
+        params.inputTransformParams.hash(hasher);
+        hasher.add(params.amount).add(params.edgeOffset).add(params.steps);
+        hashSpectralState(hasher);
+
+        return hasher.get();
+    }
+
+}
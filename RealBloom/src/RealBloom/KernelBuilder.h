@@ -0,0 +1,118 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <list>
+#include <memory>
+#include <functional>
+#include <cstdint>
+
+#include "Diffraction.h"
+#include "Dispersion.h"
+#include "Convolution.h"
+
+#include "../ColorManagement/CmImage.h"
+#include "../ColorManagement/CmXYZ.h"
+#include "../ColorManagement/CMF.h"
+
+#include "../Utils/Hash.h"
+#include "../Utils/Status.h"
+#include "../Utils/Misc.h"
+
+namespace RealBloom
+{
+
+    constexpr uint32_t KB_CACHE_CAPACITY = 8;
+
+    struct KernelBuilderParams
+    {
+        DiffractionParams diffParams;
+        bool useDispersion = true;
+        DispersionParams dispParams;
+    };
+
+    struct KernelBuilderStats
+    {
+        // Whether the stage outputs were taken from the cache
+        bool diffCached = false;
+        bool dispCached = false;
+
+        // Stage name, elapsed time in milliseconds
+        std::vector<std::pair<std::string, float>> timings;
+    };
+
+    // Builds a convolution kernel from an aperture by running diffraction
+    // and dispersion in memory. The output of every stage is cached by a
+    // hash of its input and parameters, so changing the dispersion
+    // parameters reuses the diffraction pattern. The cached buffers are
+    // shared with the images they're applied to instead of being copied.
+    class KernelBuilder
+    {
+    public:
+        KernelBuilder();
+        KernelBuilderParams* getParams();
+
+        CmImage* getImgApertureSrc();
+
+        // Optional, receives the kernel after every build
+        void setImgKernel(CmImage* image);
+
+        // Runs on the calling thread, mustCancel is polled while waiting for
+        // dispersion.
+        void build(std::function<bool()> mustCancel = nullptr);
+
+        // Shares the kernel with the kernel source image of the convolution
+        // module if the kernel or the image have changed since the last call.
+        // The kernel transform of the module is reused otherwise.
+        // Returns true if the kernel was applied.
+        bool applyTo(Convolution& conv);
+
+        uint64_t getKernelKey() const;
+        void clearCache();
+
+        const BaseStatus& getStatus() const;
+        const KernelBuilderStats& getStats() const;
+
+    private:
+        struct CacheEntry
+        {
+            uint64_t key = 0;
+            CmSharedBuffer buffer = nullptr;
+            uint32_t width = 0;
+            uint32_t height = 0;
+        };
+
+        BaseStatus m_status;
+        KernelBuilderParams m_params;
+        KernelBuilderStats m_stats;
+
+        Diffraction m_diff;
+        Dispersion m_disp;
+
+        // Previews of the transformed inputs and the raw outputs of the
+        // modules, the outputs are moved into the cache.
+        CmImage m_imgDiffInput;
+        CmImage m_imgDiffOutput;
+        CmImage m_imgDispInput;
+        CmImage m_imgDispOutput;
+
+        CmImage* m_imgKernel = nullptr;
+
+        // Most recently used first
+        std::list<std::shared_ptr<CacheEntry>> m_cache;
+
+        std::shared_ptr<CacheEntry> m_kernel = nullptr;
+        uint64_t m_appliedKey = 0;
+        uint64_t m_appliedGeneration = 0;
+        Convolution* m_appliedConv = nullptr;
+
+        std::shared_ptr<CacheEntry> cacheFind(uint64_t key);
+        std::shared_ptr<CacheEntry> cacheInsert(uint64_t key, CmImage& image);
+
+        uint64_t hashAperture();
+        uint64_t hashDiffraction(uint64_t apertureKey);
+        uint64_t hashDispersion(uint64_t diffKey);
+
+    };
+
+}
@@ -3,63 +3,147 @@
 namespace RealBloom
 {
 
+    std::shared_ptr<TransformCache::Entry> TransformCache::find(const CmImage& source, uint64_t paramsHash, bool previewMode)
+    {
+        std::scoped_lock lock(m_mutex);
+
+        uint64_t generation = source.getGeneration();
+        for (auto it = m_entries.begin(); it != m_entries.end(); it++)
+        {
+            std::shared_ptr<Entry> entry = *it;
+            if ((entry->source == &source)
+                && (entry->generation == generation)
+                && (entry->paramsHash == paramsHash)
+                && (entry->previewMode == previewMode))
+            {
+                // Move to the front
+                m_entries.erase(it);
+                m_entries.push_front(entry);
+                return entry;
+            }
+        }
+
+        return nullptr;
+    }
+
+    void TransformCache::insert(std::shared_ptr<Entry> entry)
+    {
+        std::scoped_lock lock(m_mutex);
+
+        m_entries.push_front(entry);
+        while (m_entries.size() > CAPACITY)
+            m_entries.pop_back();
+    }
+
+    void TransformCache::clear()
+    {
+        std::scoped_lock lock(m_mutex);
+        m_entries.clear();
+        m_previewEntry = nullptr;
+    }
+
+    bool TransformCache::isPreviewCurrent(const std::shared_ptr<Entry>& entry, const CmImage& imgPreview)
+    {
+        std::scoped_lock lock(m_mutex);
+        return (m_previewEntry == entry) && (m_previewGeneration == imgPreview.getGeneration());
+    }
+
+    void TransformCache::setPreviewCurrent(const std::shared_ptr<Entry>& entry, const CmImage& imgPreview)
+    {
+        std::scoped_lock lock(m_mutex);
+        m_previewEntry = entry;
+        m_previewGeneration = imgPreview.getGeneration();
+    }
+
     void processInputImage(
         bool previewMode,
         ImageTransformParams& transformParams,
         CmImage& imgSrc,
         CmImage& imgPreview,
-        std::vector<float>* outBuffer,
+        CmSharedBuffer* outBuffer,
         uint32_t* outWidth,
-        uint32_t* outHeight)
+        uint32_t* outHeight,
+        TransformCache* cache)
     {
-        // Get the input buffer
-        std::vector<float> inputBuffer;
-        uint32_t inputBufferSize = 0;
-        uint32_t inputWidth, inputHeight;
+        // The preview flag only matters when the origins are drawn
+        bool drawsMarks = previewMode && (transformParams.cropResize.previewOrigin || transformParams.transform.previewOrigin);
+
+        // The origin marks aren't part of the parameter hash, since they
+        // never change the actual result.
+        Hasher hasher;
+        transformParams.hash(hasher);
+        if (drawsMarks)
+            hasher.add(transformParams.cropResize.previewOrigin).add(transformParams.transform.previewOrigin);
+        uint64_t paramsHash = hasher.get();
+
+        std::shared_ptr<TransformCache::Entry> entry = cache ? cache->find(imgSrc, paramsHash, drawsMarks) : nullptr;
+        if (!entry)
         {
-            std::scoped_lock lock(imgSrc);
-            float* srcBuffer = imgSrc.getImageData();
-            inputBufferSize = imgSrc.getImageDataSize();
-            inputWidth = imgSrc.getWidth();
-            inputHeight = imgSrc.getHeight();
-
-            inputBuffer.resize(inputBufferSize);
-            std::copy(srcBuffer, srcBuffer + inputBufferSize, inputBuffer.data());
+            entry = std::make_shared<TransformCache::Entry>();
+            entry->source = &imgSrc;
+            entry->paramsHash = paramsHash;
+            entry->previewMode = drawsMarks;
+
+            // Take a snapshot of the source buffer instead of copying it,
+            // writers to the source will detach from it.
+            CmSharedBuffer srcBuffer;
+            uint32_t inputWidth, inputHeight;
+            {
+                std::shared_lock lock(imgSrc);
+                srcBuffer = imgSrc.shareImageData();
+                inputWidth = imgSrc.getWidth();
+                inputHeight = imgSrc.getHeight();
+                entry->generation = imgSrc.getGeneration();
+            }
+
+            // Transform
+            if (ImageTransform::isIdentity(transformParams, *srcBuffer, previewMode))
+            {
+                entry->buffer = srcBuffer;
+                entry->width = inputWidth;
+                entry->height = inputHeight;
+            }
+            else
+            {
+                std::shared_ptr<FloatBuffer> transBuffer = std::make_shared<FloatBuffer>();
+                ImageTransform::apply(
+                    transformParams,
+                    *srcBuffer,
+                    inputWidth,
+                    inputHeight,
+                    transBuffer->getVector(),
+                    entry->width,
+                    entry->height,
+                    previewMode);
+                entry->buffer = transBuffer;
+            }
+
+            if (cache)
+                cache->insert(entry);
         }
 
-        // Transform
-        std::vector<float> transBuffer;
-        uint32_t transWidth, transHeight;
-        ImageTransform::apply(
-            transformParams,
-            inputBuffer,
-            inputWidth,
-            inputHeight,
-            transBuffer,
-            transWidth,
-            transHeight,
-            previewMode);
-
-        clearVector(inputBuffer);
-
-        // Copy to outBuffer if requested by another function
+        // Share with outBuffer if requested by another function
         bool outerRequest = (!previewMode && outBuffer && outWidth && outHeight);
         if (outerRequest)
         {
-            *outWidth = transWidth;
-            *outHeight = transHeight;
-            *outBuffer = transBuffer;
+            *outWidth = entry->width;
+            *outHeight = entry->height;
+            *outBuffer = entry->buffer;
         }
 
-        // Copy to the preview image
+        // Share with the preview image
+        if (!(cache && cache->isPreviewCurrent(entry, imgPreview)))
         {
-            std::scoped_lock lock(imgPreview);
-            imgPreview.resize(transWidth, transHeight, false);
-            float* prevBuffer = imgPreview.getImageData();
-            std::copy(transBuffer.data(), transBuffer.data() + transBuffer.size(), prevBuffer);
-        }
+            {
+                std::scoped_lock lock(imgPreview);
+                imgPreview.setImageData(entry->buffer, entry->width, entry->height);
+            }
+
+            imgPreview.moveToGPU();
 
-        imgPreview.moveToGPU();
+            if (cache)
+                cache->setPreviewCurrent(entry, imgPreview);
+        }
         imgPreview.setSourceName(imgSrc.getSourceName());
     }
 
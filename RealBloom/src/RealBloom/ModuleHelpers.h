@@ -3,6 +3,8 @@
 #include <string>
 #include <vector>
 #include <array>
+#include <list>
+#include <mutex>
 #include <memory>
 #include <cstdint>
 #include <cmath>
@@ -10,18 +12,61 @@
 #include "../ColorManagement/CmImage.h"
 
 #include "../Utils/ImageTransform.h"
+#include "../Utils/Hash.h"
 #include "../Utils/Misc.h"
 
 namespace RealBloom
 {
 
+    // Results of processInputImage() for one source image, keyed by the
+    // source generation, the transform parameters, and the preview flag.
+    class TransformCache
+    {
+    public:
+        struct Entry
+        {
+            const CmImage* source = nullptr;
+            uint64_t generation = 0;
+            uint64_t paramsHash = 0;
+            bool previewMode = false;
+
+            // Shared with the source image when the transform does nothing
+            CmSharedBuffer buffer = nullptr;
+            uint32_t width = 0;
+            uint32_t height = 0;
+        };
+
+        TransformCache() {};
+
+        std::shared_ptr<Entry> find(const CmImage& source, uint64_t paramsHash, bool previewMode);
+        void insert(std::shared_ptr<Entry> entry);
+        void clear();
+
+        // Whether the preview image still holds the result of the entry
+        bool isPreviewCurrent(const std::shared_ptr<Entry>& entry, const CmImage& imgPreview);
+        void setPreviewCurrent(const std::shared_ptr<Entry>& entry, const CmImage& imgPreview);
+
+    private:
+        static constexpr uint32_t CAPACITY = 2;
+
+        std::mutex m_mutex;
+
+        // Most recently used first
+        std::list<std::shared_ptr<Entry>> m_entries;
+
+        std::shared_ptr<Entry> m_previewEntry = nullptr;
+        uint64_t m_previewGeneration = 0;
+
+    };
+
     void processInputImage(
         bool previewMode,
         ImageTransformParams& transformParams,
         CmImage& imgSrc,
         CmImage& imgPreview,
-        std::vector<float>* outBuffer = nullptr,
+        CmSharedBuffer* outBuffer = nullptr,
         uint32_t* outWidth = nullptr,
-        uint32_t* outHeight = nullptr);
+        uint32_t* outHeight = nullptr,
+        TransformCache* cache = nullptr);
 
 }
@@ -2,16 +2,17 @@
 
 #include <vector>
 
+#include "BufferPool.h"
 #include "Misc.h"
 
-// 2D Array
+// 2D Array, the storage comes from the buffer pool
 template <typename T>
 class Array2D
 {
 public:
     Array2D() {};
 
-    std::vector<T>& getVector();
+    PooledVector<T>& getVector();
     size_t getNumRows() const;
     size_t getNumCols() const;
 
@@ -23,14 +24,14 @@ public:
     const T& operator()(const size_t& row, const size_t& col) const;
 
 private:
-    std::vector<T> m_vector;
+    PooledVector<T> m_vector;
     size_t m_rows = 0;
     size_t m_cols = 0;
 
 };
 
 template <typename T>
-std::vector<T>& Array2D<T>::getVector()
+PooledVector<T>& Array2D<T>::getVector()
 {
     return m_vector;
 }
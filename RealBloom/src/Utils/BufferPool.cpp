@@ -0,0 +1,143 @@
+#include "BufferPool.h"
+
+#include <new>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+std::list<BufferPool::Block> BufferPool::S_IDLE;
+size_t BufferPool::S_CAPACITY = BUFFER_POOL_DEFAULT_CAPACITY;
+BufferPoolStats BufferPool::S_STATS;
+std::mutex BufferPool::S_MUTEX;
+std::atomic_bool BufferPool::S_ENABLED = true;
+
+void* BufferPool::allocate(size_t numBytes)
+{
+    size_t size = getBucketSize(numBytes);
+
+    if (S_ENABLED && (size >= BUFFER_POOL_MIN_SIZE))
+    {
+        std::scoped_lock lock(S_MUTEX);
+        for (auto it = S_IDLE.begin(); it != S_IDLE.end(); it++)
+        {
+            if (it->size == size)
+            {
+                void* ptr = it->ptr;
+                S_IDLE.erase(it);
+                S_STATS.idleSize -= size;
+                S_STATS.numHits++;
+                return ptr;
+            }
+        }
+        S_STATS.numMisses++;
+    }
+
+    return allocateBlock(size);
+}
+
+void BufferPool::deallocate(void* ptr, size_t numBytes)
+{
+    if (!ptr)
+        return;
+
+    size_t size = getBucketSize(numBytes);
+
+    if (S_ENABLED && (size >= BUFFER_POOL_MIN_SIZE))
+    {
+        std::scoped_lock lock(S_MUTEX);
+        if (size <= S_CAPACITY)
+        {
+            evict(S_CAPACITY - size);
+            S_IDLE.push_front({ ptr, size });
+            S_STATS.idleSize += size;
+            return;
+        }
+    }
+
+    freeBlock(ptr, size);
+}
+
+size_t BufferPool::getCapacity()
+{
+    std::scoped_lock lock(S_MUTEX);
+    return S_CAPACITY;
+}
+
+void BufferPool::setCapacity(size_t numBytes)
+{
+    std::scoped_lock lock(S_MUTEX);
+    S_CAPACITY = numBytes;
+    evict(S_CAPACITY);
+}
+
+void BufferPool::trim()
+{
+    std::scoped_lock lock(S_MUTEX);
+    evict(0);
+}
+
+BufferPoolStats BufferPool::getStats()
+{
+    std::scoped_lock lock(S_MUTEX);
+    return S_STATS;
+}
+
+void BufferPool::cleanUp()
+{
+    S_ENABLED = false;
+    trim();
+}
+
+size_t BufferPool::getBucketSize(size_t numBytes)
+{
+    if (numBytes < BUFFER_POOL_MIN_SIZE)
+        return numBytes;
+
+    // 8 buckets per power of two
+    size_t p = 1;
+    while ((p << 1) <= numBytes)
+        p <<= 1;
+
+    size_t step = p / 8;
+    return ((numBytes + step - 1) / step) * step;
+}
+
+void* BufferPool::allocateBlock(size_t size)
+{
+    if (size >= BUFFER_POOL_HUGE_PAGE_SIZE)
+    {
+        void* ptr = ::operator new(size, std::align_val_t(BUFFER_POOL_HUGE_PAGE_SIZE));
+
+        // Transparent huge pages cut the number of page faults and TLB misses
+        // for large buffers. Windows needs a special privilege for large
+        // pages, so we only align there.
+#ifdef __linux__
+        madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+
+        return ptr;
+    }
+
+    return ::operator new(size, std::align_val_t(BUFFER_POOL_ALIGNMENT));
+}
+
+void BufferPool::freeBlock(void* ptr, size_t size)
+{
+    if (size >= BUFFER_POOL_HUGE_PAGE_SIZE)
+        ::operator delete(ptr, std::align_val_t(BUFFER_POOL_HUGE_PAGE_SIZE));
+    else
+        ::operator delete(ptr, std::align_val_t(BUFFER_POOL_ALIGNMENT));
+}
+
+void BufferPool::evict(size_t maxIdleSize)
+{
+    // Called while locked
+    while ((S_STATS.idleSize > maxIdleSize) && !S_IDLE.empty())
+    {
+        Block& block = S_IDLE.back();
+        freeBlock(block.ptr, block.size);
+        S_STATS.idleSize -= block.size;
+        S_IDLE.pop_back();
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <vector>
+#include <list>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+// Blocks smaller than this aren't kept, they're cheap to allocate
+constexpr size_t BUFFER_POOL_MIN_SIZE = 256 * 1024;
+
+// Blocks at least this large are aligned to and advised as huge pages
+constexpr size_t BUFFER_POOL_HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+constexpr size_t BUFFER_POOL_ALIGNMENT = 64;
+constexpr size_t BUFFER_POOL_DEFAULT_CAPACITY = (size_t)1024 * 1024 * 1024;
+
+struct BufferPoolStats
+{
+    size_t idleSize = 0;
+    uint64_t numHits = 0;
+    uint64_t numMisses = 0;
+};
+
+// Keeps large scratch buffers around after they're released so that the
+// next run with similar dimensions gets memory that's already mapped and
+// faulted in. Sizes are rounded up to buckets that waste at most 1/8 of
+// the block. (Global)
+class BufferPool
+{
+public:
+    BufferPool() = delete;
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator= (const BufferPool&) = delete;
+
+    // Aligned to BUFFER_POOL_ALIGNMENT, numBytes must be the same for
+    // deallocate().
+    static void* allocate(size_t numBytes);
+    static void deallocate(void* ptr, size_t numBytes);
+
+    // Maximum size of the idle blocks in bytes, the least recently released
+    // blocks are freed first.
+    static size_t getCapacity();
+    static void setCapacity(size_t numBytes);
+
+    // Frees the idle blocks
+    static void trim();
+    static BufferPoolStats getStats();
+
+    // Blocks released after this are freed immediately
+    static void cleanUp();
+
+private:
+    struct Block
+    {
+        void* ptr = nullptr;
+        size_t size = 0;
+    };
+
+    // Most recently released first
+    static std::list<Block> S_IDLE;
+    static size_t S_CAPACITY;
+    static BufferPoolStats S_STATS;
+    static std::mutex S_MUTEX;
+    static std::atomic_bool S_ENABLED;
+
+    static size_t getBucketSize(size_t numBytes);
+    static void* allocateBlock(size_t size);
+    static void freeBlock(void* ptr, size_t size);
+    static void evict(size_t maxIdleSize);
+
+};
+
+// Allocator for std::vector that draws from the buffer pool
+template <typename T>
+struct PooledAllocator
+{
+    using value_type = T;
+
+    PooledAllocator() noexcept {};
+
+    template <typename U>
+    PooledAllocator(const PooledAllocator<U>&) noexcept {};
+
+    T* allocate(size_t n)
+    {
+        return static_cast<T*>(BufferPool::allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n) noexcept
+    {
+        BufferPool::deallocate(p, n * sizeof(T));
+    }
+
+    template <typename U>
+    bool operator==(const PooledAllocator<U>&) const noexcept
+    {
+        return true;
+    }
+
+    template <typename U>
+    bool operator!=(const PooledAllocator<U>&) const noexcept
+    {
+        return false;
+    }
+};
+
+template <typename T>
+using PooledVector = std::vector<T, PooledAllocator<T>>;
@@ -0,0 +1,97 @@
+#include "ChirpZ.h"
+
+static std::complex<double> expI(double cycles)
+{
+    // exp(2*pi*i * cycles), with the whole number of turns taken out first
+    cycles -= floor(cycles);
+    return std::polar(1.0, 2.0 * std::numbers::pi * cycles);
+}
+
+ChirpZ::ChirpZ(uint32_t inputSize, uint32_t outputSize, double f0, double df)
+    : m_inputSize(inputSize), m_outputSize(outputSize)
+{
+    // Linear convolution of inputSize and outputSize samples
+    m_convSize = upperSmoothNumber(inputSize + outputSize - 1);
+    m_plan = std::make_shared<Plan>(m_convSize);
+
+    m_inputChirp.resize(inputSize);
+    for (uint32_t n = 0; n < inputSize; n++)
+    {
+        double nd = (double)n;
+        m_inputChirp[n] = (std::complex<float>)(expI(-f0 * nd) * expI(-0.5 * df * nd * nd));
+    }
+
+    const double scale = 1.0 / (double)m_convSize;
+    m_outputChirp.resize(outputSize);
+    for (uint32_t k = 0; k < outputSize; k++)
+    {
+        double kd = (double)k;
+        m_outputChirp[k] = (std::complex<float>)(expI(-0.5 * df * kd * kd) * scale);
+    }
+
+    // Wrap the negative indices around for circular convolution
+    m_filterFT.resize(m_convSize, 0.0f);
+    for (int t = -(int)(inputSize - 1); t < (int)outputSize; t++)
+    {
+        double td = (double)t;
+        uint32_t index = (t < 0) ? (uint32_t)(t + (int)m_convSize) : (uint32_t)t;
+        m_filterFT[index] = (std::complex<float>)expI(0.5 * df * td * td);
+    }
+    m_plan->exec((pocketfft::detail::cmplx<float>*)m_filterFT.data(), 1.0f, true);
+}
+
+uint32_t ChirpZ::getInputSize() const
+{
+    return m_inputSize;
+}
+
+uint32_t ChirpZ::getOutputSize() const
+{
+    return m_outputSize;
+}
+
+uint32_t ChirpZ::getConvSize() const
+{
+    return m_convSize;
+}
+
+void ChirpZ::apply(
+    const std::complex<float>* input, size_t inputStride,
+    std::complex<float>* output, size_t outputStride,
+    std::vector<std::complex<float>>& scratch) const
+{
+    scratch.resize(m_convSize);
+
+    for (uint32_t n = 0; n < m_inputSize; n++)
+        scratch[n] = input[n * inputStride] * m_inputChirp[n];
+    std::fill(scratch.begin() + m_inputSize, scratch.end(), 0.0f);
+
+    convolve(scratch.data(), output, outputStride);
+}
+
+void ChirpZ::apply(
+    const float* input, size_t inputStride,
+    std::complex<float>* output, size_t outputStride,
+    std::vector<std::complex<float>>& scratch) const
+{
+    scratch.resize(m_convSize);
+
+    for (uint32_t n = 0; n < m_inputSize; n++)
+        scratch[n] = input[n * inputStride] * m_inputChirp[n];
+    std::fill(scratch.begin() + m_inputSize, scratch.end(), 0.0f);
+
+    convolve(scratch.data(), output, outputStride);
+}
+
+void ChirpZ::convolve(std::complex<float>* data, std::complex<float>* output, size_t outputStride) const
+{
+    pocketfft::detail::cmplx<float>* c = (pocketfft::detail::cmplx<float>*)data;
+
+    m_plan->exec(c, 1.0f, true);
+    for (uint32_t i = 0; i < m_convSize; i++)
+        data[i] *= m_filterFT[i];
+    m_plan->exec(c, 1.0f, false);
+
+    for (uint32_t k = 0; k < m_outputSize; k++)
+        output[k * outputStride] = data[k] * m_outputChirp[k];
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <complex>
+#include <memory>
+#include <cstdint>
+#include <cmath>
+
+#include "pocketfft/pocketfft_hdronly.h"
+
+#include "NumberHelpers.h"
+
+// Chirp-z transform (Bluestein's algorithm)
+// Evaluates the DFT of inputSize samples at outputSize frequencies
+// f0, f0 + df, ..., f0 + (outputSize - 1) * df, in cycles per sample.
+// The frequencies don't need to be on the regular FFT grid, so this
+// can be used to zoom into a part of the spectrum.
+class ChirpZ
+{
+public:
+    ChirpZ(uint32_t inputSize, uint32_t outputSize, double f0, double df);
+
+    ChirpZ(const ChirpZ&) = delete;
+    ChirpZ& operator= (const ChirpZ&) = delete;
+
+    uint32_t getInputSize() const;
+    uint32_t getOutputSize() const;
+    uint32_t getConvSize() const;
+
+    // Strides are in elements. scratch is resized as needed, so reusing
+    // it avoids allocations. Thread-safe as long as each thread has its
+    // own scratch buffer.
+    void apply(
+        const std::complex<float>* input, size_t inputStride,
+        std::complex<float>* output, size_t outputStride,
+        std::vector<std::complex<float>>& scratch) const;
+
+    // Same as above, for real input
+    void apply(
+        const float* input, size_t inputStride,
+        std::complex<float>* output, size_t outputStride,
+        std::vector<std::complex<float>>& scratch) const;
+
+private:
+    typedef pocketfft::detail::pocketfft_c<float> Plan;
+
+    uint32_t m_inputSize;
+    uint32_t m_outputSize;
+    uint32_t m_convSize;
+
+    std::shared_ptr<Plan> m_plan;
+
+    // exp(-2*pi*i * f0 * n) * exp(-pi*i * df * n^2)
+    std::vector<std::complex<float>> m_inputChirp;
+
+    // exp(-pi*i * df * k^2) / convSize
+    std::vector<std::complex<float>> m_outputChirp;
+
+    // FFT of exp(pi*i * df * t^2), t = -(inputSize - 1) ... (outputSize - 1)
+    std::vector<std::complex<float>> m_filterFT;
+
+    void convolve(std::complex<float>* data, std::complex<float>* output, size_t outputStride) const;
+
+};
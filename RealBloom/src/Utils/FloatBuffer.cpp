@@ -0,0 +1,68 @@
+#include "FloatBuffer.h"
+#include "Misc.h"
+
+FloatBuffer::FloatBuffer(size_t size)
+    : m_vector(size)
+{}
+
+FloatBuffer::FloatBuffer(std::vector<float>&& data)
+    : m_vector(std::move(data))
+{}
+
+FloatBuffer::FloatBuffer(const FloatBuffer& other)
+    : m_vector(other.begin(), other.end())
+{}
+
+std::shared_ptr<FloatBuffer> FloatBuffer::wrap(std::shared_ptr<const void> owner, const float* data, size_t size)
+{
+    if (!owner || !data)
+        throw std::exception(makeError(__FUNCTION__, "", "Invalid data").c_str());
+
+    std::shared_ptr<FloatBuffer> buffer = std::make_shared<FloatBuffer>();
+    buffer->m_owner = owner;
+    buffer->m_external = data;
+    buffer->m_externalSize = size;
+    return buffer;
+}
+
+bool FloatBuffer::isWrapped() const
+{
+    return m_external != nullptr;
+}
+
+const float* FloatBuffer::data() const
+{
+    return m_external ? m_external : m_vector.data();
+}
+
+size_t FloatBuffer::size() const
+{
+    return m_external ? m_externalSize : m_vector.size();
+}
+
+bool FloatBuffer::empty() const
+{
+    return size() < 1;
+}
+
+const float& FloatBuffer::operator[](size_t index) const
+{
+    return data()[index];
+}
+
+const float* FloatBuffer::begin() const
+{
+    return data();
+}
+
+const float* FloatBuffer::end() const
+{
+    return data() + size();
+}
+
+std::vector<float>& FloatBuffer::getVector()
+{
+    if (m_external)
+        throw std::exception(makeError(__FUNCTION__, "", "The buffer is read-only").c_str());
+    return m_vector;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+// Floats that are either owned, or live in memory owned by something else,
+// like a mapped file, which is kept alive as long as the buffer. Reads the
+// same way as a const std::vector<float> in both cases.
+class FloatBuffer
+{
+public:
+    FloatBuffer() {};
+    FloatBuffer(size_t size);
+    FloatBuffer(std::vector<float>&& data);
+
+    // The copy is always owned
+    FloatBuffer(const FloatBuffer& other);
+    FloatBuffer& operator= (const FloatBuffer&) = delete;
+
+    // Nothing is copied, data must stay valid as long as owner is alive
+    static std::shared_ptr<FloatBuffer> wrap(std::shared_ptr<const void> owner, const float* data, size_t size);
+    bool isWrapped() const;
+
+    const float* data() const;
+    size_t size() const;
+    bool empty() const;
+    const float& operator[] (size_t index) const;
+    const float* begin() const;
+    const float* end() const;
+
+    // For writing, throws if the buffer is wrapped
+    std::vector<float>& getVector();
+
+private:
+    std::vector<float> m_vector;
+
+    // Used instead of the vector when wrapping
+    std::shared_ptr<const void> m_owner = nullptr;
+    const float* m_external = nullptr;
+    size_t m_externalSize = 0;
+
+};
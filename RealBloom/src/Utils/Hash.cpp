@@ -0,0 +1,72 @@
+#include "Hash.h"
+
+#include <algorithm>
+#include <cstring>
+
+static constexpr uint64_t FNV_PRIME = 1099511628211ull;
+static constexpr uint64_t FNV_OFFSET = 14695981039346656037ull;
+
+// Size of the blocks hashed in parallel by addLarge()
+static constexpr size_t HASH_BLOCK_SIZE = 1024 * 1024;
+
+// FNV-1a on 8-byte words, then on the remaining bytes
+static uint64_t hashBlock(const uint8_t* data, size_t size)
+{
+    uint64_t hash = FNV_OFFSET;
+
+    size_t numWords = size / sizeof(uint64_t);
+    for (size_t i = 0; i < numWords; i++)
+    {
+        uint64_t word;
+        std::memcpy(&word, data + (i * sizeof(uint64_t)), sizeof(uint64_t));
+        hash ^= word;
+        hash *= FNV_PRIME;
+    }
+
+    for (size_t i = numWords * sizeof(uint64_t); i < size; i++)
+    {
+        hash ^= data[i];
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
+
+Hasher& Hasher::add(const void* data, size_t size)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        m_hash ^= bytes[i];
+        m_hash *= FNV_PRIME;
+    }
+    return *this;
+}
+
+Hasher& Hasher::add(const std::string& s)
+{
+    add((uint64_t)s.size());
+    return add(s.data(), s.size());
+}
+
+Hasher& Hasher::addLarge(const void* data, size_t size)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    size_t numBlocks = (size + HASH_BLOCK_SIZE - 1) / HASH_BLOCK_SIZE;
+    std::vector<uint64_t> blockHashes(numBlocks);
+
+#pragma omp parallel for
+    for (int i = 0; i < (int)numBlocks; i++)
+    {
+        size_t start = (size_t)i * HASH_BLOCK_SIZE;
+        blockHashes[i] = hashBlock(bytes + start, std::min(HASH_BLOCK_SIZE, size - start));
+    }
+
+    add((uint64_t)size);
+    return add(blockHashes.data(), blockHashes.size() * sizeof(uint64_t));
+}
+
+uint64_t Hasher::get() const
+{
+    return m_hash;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <array>
+#include <type_traits>
+#include <cstdint>
+
+// Incremental 64-bit FNV-1a hash
+class Hasher
+{
+public:
+    Hasher() {};
+
+    Hasher& add(const void* data, size_t size);
+    Hasher& add(const std::string& s);
+
+    // For large buffers like pixels. Blocks are hashed in parallel, 8 bytes
+    // at a time, and then the block hashes are added. Gives a different
+    // result than add().
+    Hasher& addLarge(const void* data, size_t size);
+
+    // Scalars and enums, no structs since their padding is undefined
+    template <typename T>
+    Hasher& add(const T& value);
+
+    template <typename T, size_t N>
+    Hasher& add(const std::array<T, N>& values);
+
+    uint64_t get() const;
+
+private:
+    uint64_t m_hash = 14695981039346656037ull;
+
+};
+
+template <typename T>
+Hasher& Hasher::add(const T& value)
+{
+    static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>, "Only scalars and enums can be hashed directly.");
+    return add(&value, sizeof(T));
+}
+
+template <typename T, size_t N>
+Hasher& Hasher::add(const std::array<T, N>& values)
+{
+    for (const auto& v : values)
+        add(v);
+    return *this;
+}
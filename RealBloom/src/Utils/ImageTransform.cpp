@@ -1,6 +1,7 @@
 #include "ImageTransform.h"
 
 #include <omp.h>
+#include <emmintrin.h>
 
 #pragma region Shaders
 static const char* fragmentSource = R"glsl(
@@ -264,6 +265,21 @@ void ImageTransformParams::ColorParams::reset()
     grayscaleMix = 1.0f;
 }
 
+void ImageTransformParams::CropResizeParams::hash(Hasher& hasher) const
+{
+    hasher.add(crop).add(resize).add(origin);
+}
+
+void ImageTransformParams::TransformParams::hash(Hasher& hasher) const
+{
+    hasher.add(scale).add(rotate).add(translate).add(origin);
+}
+
+void ImageTransformParams::ColorParams::hash(Hasher& hasher) const
+{
+    hasher.add(filter).add(exposure).add(contrast).add(contrastGrayscaleType).add(grayscaleType).add(grayscaleMix);
+}
+
 void ImageTransformParams::reset()
 {
     cropResize.reset();
@@ -272,6 +288,14 @@ void ImageTransformParams::reset()
     transparency = false;
 }
 
+void ImageTransformParams::hash(Hasher& hasher) const
+{
+    cropResize.hash(hasher);
+    transform.hash(hasher);
+    color.hash(hasher);
+    hasher.add(transparency);
+}
+
 bool ImageTransform::S_USE_GPU = false;
 
 GLuint ImageTransform::s_vertShader = 0;
@@ -328,11 +352,84 @@ void ImageTransform::ensureInitGPU()
     }
 }
 
-void ImageTransform::applyNoCropCPU(
+// Color operations after sampling: filter, exposure, contrast, grayscale
+struct ImageTransformColorOps
+{
+    __m128 colorMul;
+    __m128 alphaMask;
+    __m128 alphaAdd;
+    float contrast;
+    GrayscaleType contrastGrayscaleType;
+    GrayscaleType grayscaleType;
+    float grayscaleMix;
+    bool useContrast;
+    bool grayscale;
+    bool grayscaleMixing;
+
+    inline void apply(__m128 color, float* target) const
+    {
+        // Filter, Exposure, and the alpha channel if there's no transparency
+        color = _mm_add_ps(_mm_and_ps(_mm_mul_ps(color, colorMul), alphaMask), alphaAdd);
+
+        if (!(useContrast || grayscale))
+        {
+            _mm_storeu_ps(target, color);
+            return;
+        }
+
+        float targetColor[4];
+        _mm_storeu_ps(targetColor, color);
+
+        // Contrast
+        if (useContrast)
+        {
+            float mono = rgbaToGrayscale(targetColor, contrastGrayscaleType);
+            if (mono > 0.0f)
+            {
+                float mul = applyContrast(mono, contrast) / mono;
+                targetColor[0] *= mul;
+                targetColor[1] *= mul;
+                targetColor[2] *= mul;
+            }
+        }
+
+        // Grayscale
+        if (grayscale)
+        {
+            float v = rgbaToGrayscale(targetColor, grayscaleType);
+            if (grayscaleMixing)
+            {
+                targetColor[0] = lerp(targetColor[0], v, grayscaleMix);
+                targetColor[1] = lerp(targetColor[1], v, grayscaleMix);
+                targetColor[2] = lerp(targetColor[2], v, grayscaleMix);
+            }
+            else
+            {
+                targetColor[0] = v;
+                targetColor[1] = v;
+                targetColor[2] = v;
+            }
+            targetColor[3] = 1.0f;
+        }
+
+        std::copy(targetColor, targetColor + 4, target);
+    }
+};
+
+static inline __m128 lerpPixels(__m128 a, __m128 b, __m128 t)
+{
+    return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t));
+}
+
+void ImageTransform::applyCPU(
     const ImageTransformParams& params,
-    const std::vector<float>* lastBuffer,
-    uint32_t lastBufferWidth,
-    uint32_t lastBufferHeight,
+    const FloatBuffer& inputBuffer,
+    uint32_t inputWidth,
+    uint32_t inputHeight,
+    uint32_t cropStartX,
+    uint32_t cropStartY,
+    uint32_t croppedWidth,
+    uint32_t croppedHeight,
     std::vector<float>& outputBuffer,
     uint32_t resizedWidth,
     uint32_t resizedHeight,
@@ -355,19 +452,10 @@ void ImageTransform::applyNoCropCPU(
     // Scale (non-zero)
     float scaleX = params.transform.scale[0];
     float scaleY = params.transform.scale[1];
-    if (scaleX == 0.0f) scaleX == EPSILON;
-    if (scaleY == 0.0f) scaleY == EPSILON;
-
-    // Color multiplier
-    const float expMul = getExposureMul(params.color.exposure);
-    const float colorMulR = expMul * params.color.filter[0];
-    const float colorMulG = expMul * params.color.filter[1];
-    const float colorMulB = expMul * params.color.filter[2];
+    if (scaleX == 0.0f) scaleX = EPSILON;
+    if (scaleY == 0.0f) scaleY = EPSILON;
 
     const bool grayscale = (params.color.grayscaleType != GrayscaleType::None);
-    const bool grayscaleMixing = (params.color.grayscaleMix != 1.0f);
-
-    const bool transparency = params.transparency;
 
     // Check if we'll need to draw preview marks for crop and transform origins
     const bool previewOrigins = (params.cropResize.previewOrigin || params.transform.previewOrigin) && previewMode;
@@ -387,140 +475,185 @@ void ImageTransform::applyNoCropCPU(
         && (params.color.filter[2] == 1.0f)
         && (params.color.exposure == 0.0f)
         && (params.color.contrast == 0.0f)
-        && (!grayscale);
+        && (!grayscale)
+        && (croppedWidth <= inputWidth)
+        && (croppedHeight <= inputHeight);
 
-    // Resize, Scale, Rotate, Translate, Color Transforms
+    // Crop, Resize, Scale, Rotate, Translate, Color Transforms
     if (noTrans)
     {
-        outputBuffer = *lastBuffer;
-
-        // Reset the alpha channel if there's no transparency
-        if (!params.transparency)
+        // Copy the cropped area
+#pragma omp parallel for
+        for (int y = 0; y < (int)croppedHeight; y++)
         {
-            for (uint32_t i = 0; i < outputBuffer.size(); i++)
-                if (i % 4 == 3) outputBuffer[i] = 1.0f;
+            const float* srcRow = &(inputBuffer[(((y + cropStartY) * inputWidth) + cropStartX) * 4]);
+            float* dstRow = &(outputBuffer[y * croppedWidth * 4]);
+            std::copy(srcRow, srcRow + (croppedWidth * 4), dstRow);
+
+            // Reset the alpha channel if there's no transparency
+            if (!params.transparency)
+            {
+                for (uint32_t x = 0; x < croppedWidth; x++)
+                    dstRow[x * 4 + 3] = 1.0f;
+            }
         }
     }
     else
     {
-#pragma omp parallel for
-        for (int y = 0; y < resizedHeight; y++)
+        // Translate, rotate, scale, and resize are combined into one affine
+        // transform from output pixel centers to the cropped image, which is
+        // offset to the input image. The half pixel for bilinear
+        // interpolation is also taken out here.
+        const float angle = -params.transform.rotate * DEG_TO_RAD;
+        const float s = sinf(angle);
+        const float c = cosf(angle);
+
+        const float pivotX = (params.transform.translate[0] * resizedWidth) + transformOriginX;
+        const float pivotY = (params.transform.translate[1] * resizedHeight) + transformOriginY;
+
+        const float mulX = 1.0f / (scaleX * resizeX);
+        const float mulY = 1.0f / (scaleY * resizeY);
+
+        // u = (uX * x) + (uY * y) + u0, v = (vX * x) + (vY * y) + v0
+        const float uX = c * mulX;
+        const float uY = -s * mulX;
+        const float u0 = ((c * (0.5f - pivotX)) - (s * (0.5f - pivotY))) * mulX + (transformOriginX / resizeX) - 0.5f;
+        const float vX = s * mulY;
+        const float vY = c * mulY;
+        const float v0 = ((s * (0.5f - pivotX)) + (c * (0.5f - pivotY))) * mulY + (transformOriginY / resizeY) - 0.5f;
+
+        ImageTransformColorOps colorOps;
         {
-            uint32_t redIndexInput, redIndexOutput;
-            float transX, transY;
-            float targetColor[4]{ 0.0f, 0.0f, 0.0f, 0.0f };
-            Bilinear bil;
+            const float expMul = getExposureMul(params.color.exposure);
+            colorOps.colorMul = _mm_setr_ps(
+                expMul * params.color.filter[0],
+                expMul * params.color.filter[1],
+                expMul * params.color.filter[2],
+                1.0f);
 
-            for (int x = 0; x < resizedWidth; x++)
-            {
-                // Translate
-                transX = (x + 0.5f) - (params.transform.translate[0] * resizedWidth);
-                transY = (y + 0.5f) - (params.transform.translate[1] * resizedHeight);
+            const __m128 allBits = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            colorOps.alphaMask = params.transparency ? allBits : _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+            colorOps.alphaAdd = params.transparency ? _mm_setzero_ps() : _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+
+            colorOps.contrast = params.color.contrast;
+            colorOps.contrastGrayscaleType = params.color.contrastGrayscaleType;
+            colorOps.grayscaleType = params.color.grayscaleType;
+            colorOps.grayscaleMix = params.color.grayscaleMix;
+            colorOps.useContrast = (params.color.contrast != 0.0f);
+            colorOps.grayscale = grayscale;
+            colorOps.grayscaleMixing = (params.color.grayscaleMix != 1.0f);
+        }
 
-                // Rotate
-                rotatePointInPlace(transX, transY, transformOriginX, transformOriginY, -params.transform.rotate);
+        // Pixels beyond the input are zero if the crop is larger than 1
+        const int cropW = (int)std::min(croppedWidth, inputWidth - cropStartX);
+        const int cropH = (int)std::min(croppedHeight, inputHeight - cropStartY);
+        const float* cropData = &(inputBuffer[((cropStartY * inputWidth) + cropStartX) * 4]);
+        const uint32_t inputStride = inputWidth * 4;
 
-                // Scale
-                transX = ((transX - transformOriginX) / scaleX) + transformOriginX;
-                transY = ((transY - transformOriginY) / scaleY) + transformOriginY;
+        // Gathers a pixel from the cropped image, zero outside
+        auto getPixel = [cropData, inputStride, cropW, cropH](int px, int py) -> __m128
+        {
+            if ((px < 0) || (py < 0) || (px >= cropW) || (py >= cropH))
+                return _mm_setzero_ps();
+            return _mm_loadu_ps(cropData + (py * inputStride) + (px * 4));
+        };
 
-                // Resize
-                transX /= resizeX;
-                transY /= resizeY;
+#pragma omp parallel for
+        for (int y = 0; y < (int)resizedHeight; y++)
+        {
+            float* outRow = &(outputBuffer[y * resizedWidth * 4]);
 
-                // Interpolate
-                bil.calc(transX, transY);
-                for (auto& v : targetColor) v = 0.0f;
-                if (params.transparency)
-                {
-                    if (checkBounds(bil.topLeftPos[0], bil.topLeftPos[1], lastBufferWidth, lastBufferHeight))
-                    {
-                        redIndexInput = (bil.topLeftPos[1] * lastBufferWidth + bil.topLeftPos[0]) * 4;
-                        blendAddRGBA(targetColor, 0, (*lastBuffer).data(), redIndexInput, bil.topLeftWeight);
-                    }
-                    if (checkBounds(bil.topRightPos[0], bil.topRightPos[1], lastBufferWidth, lastBufferHeight))
-                    {
-                        redIndexInput = (bil.topRightPos[1] * lastBufferWidth + bil.topRightPos[0]) * 4;
-                        blendAddRGBA(targetColor, 0, (*lastBuffer).data(), redIndexInput, bil.topRightWeight);
-                    }
-                    if (checkBounds(bil.bottomLeftPos[0], bil.bottomLeftPos[1], lastBufferWidth, lastBufferHeight))
-                    {
-                        redIndexInput = (bil.bottomLeftPos[1] * lastBufferWidth + bil.bottomLeftPos[0]) * 4;
-                        blendAddRGBA(targetColor, 0, (*lastBuffer).data(), redIndexInput, bil.bottomLeftWeight);
-                    }
-                    if (checkBounds(bil.bottomRightPos[0], bil.bottomRightPos[1], lastBufferWidth, lastBufferHeight))
-                    {
-                        redIndexInput = (bil.bottomRightPos[1] * lastBufferWidth + bil.bottomRightPos[0]) * 4;
-                        blendAddRGBA(targetColor, 0, (*lastBuffer).data(), redIndexInput, bil.bottomRightWeight);
-                    }
-                }
-                else
+            // Source coordinates step linearly along the row
+            const float uRow = (uY * y) + u0;
+            const float vRow = (vY * y) + v0;
+
+            // Interior span where all 4 taps are inside the cropped image
+            int spanStart = 0, spanEnd = 0;
+            if ((cropW > 1) && (cropH > 1))
+            {
+                float lo = 0.0f, hi = (float)resizedWidth;
+                auto clip = [&lo, &hi](float start, float step, float maxValue)
                 {
-                    targetColor[3] = 1.0f;
-                    if (checkBounds(bil.topLeftPos[0], bil.topLeftPos[1], lastBufferWidth, lastBufferHeight))
+                    // 0 <= start + step * x < maxValue
+                    if (step == 0.0f)
                     {
-                        redIndexInput = (bil.topLeftPos[1] * lastBufferWidth + bil.topLeftPos[0]) * 4;
-                        blendAddRGB(targetColor, 0, (*lastBuffer).data(), redIndexInput, bil.topLeftWeight);
+                        if ((start < 0.0f) || (start >= maxValue))
+                            hi = lo;
                     }
-                    if (checkBounds(bil.topRightPos[0], bil.topRightPos[1], lastBufferWidth, lastBufferHeight))
+                    else if (step > 0.0f)
                     {
-                        redIndexInput = (bil.topRightPos[1] * lastBufferWidth + bil.topRightPos[0]) * 4;
-                        blendAddRGB(targetColor, 0, (*lastBuffer).data(), redIndexInput, bil.topRightWeight);
+                        lo = fmaxf(lo, -start / step);
+                        hi = fminf(hi, (maxValue - start) / step);
                     }
-                    if (checkBounds(bil.bottomLeftPos[0], bil.bottomLeftPos[1], lastBufferWidth, lastBufferHeight))
-                    {
-                        redIndexInput = (bil.bottomLeftPos[1] * lastBufferWidth + bil.bottomLeftPos[0]) * 4;
-                        blendAddRGB(targetColor, 0, (*lastBuffer).data(), redIndexInput, bil.bottomLeftWeight);
-                    }
-                    if (checkBounds(bil.bottomRightPos[0], bil.bottomRightPos[1], lastBufferWidth, lastBufferHeight))
+                    else
                     {
-                        redIndexInput = (bil.bottomRightPos[1] * lastBufferWidth + bil.bottomRightPos[0]) * 4;
-                        blendAddRGB(targetColor, 0, (*lastBuffer).data(), redIndexInput, bil.bottomRightWeight);
+                        lo = fmaxf(lo, (maxValue - start) / step);
+                        hi = fminf(hi, -start / step);
                     }
-                }
+                };
+                clip(uRow, uX, (float)(cropW - 1));
+                clip(vRow, vX, (float)(cropH - 1));
 
-                // Filter, Exposure
-                targetColor[0] *= colorMulR;
-                targetColor[1] *= colorMulG;
-                targetColor[2] *= colorMulB;
-
-                // Get the monotonic value for contrast
-                float mono = rgbaToGrayscale(targetColor, params.color.contrastGrayscaleType);
-
-                // Contrast
-                if (mono > 0.0f)
+                if (hi > lo)
                 {
-                    float mul = applyContrast(mono, params.color.contrast) / mono;
-                    targetColor[0] *= mul;
-                    targetColor[1] *= mul;
-                    targetColor[2] *= mul;
+                    spanStart = std::clamp((int)ceilf(lo), 0, (int)resizedWidth);
+                    spanEnd = std::clamp((int)floorf(hi) + 1, spanStart, (int)resizedWidth);
                 }
 
-                // Grayscale
-                if (grayscale)
+                // The bounds above are approximate, shrink the span until the
+                // pixels on both ends are inside.
+                auto isInside = [uRow, vRow, uX, vX, cropW, cropH](int x)
                 {
-                    if (grayscaleMixing)
-                    {
-                        float v = rgbaToGrayscale(targetColor, params.color.grayscaleType);
+                    float u = uRow + (uX * x);
+                    float v = vRow + (vX * x);
+                    return (u >= 0.0f) && (v >= 0.0f) && (u < (float)(cropW - 1)) && (v < (float)(cropH - 1));
+                };
+                while ((spanStart < spanEnd) && !isInside(spanStart))
+                    spanStart++;
+                while ((spanEnd > spanStart) && !isInside(spanEnd - 1))
+                    spanEnd--;
+            }
 
-                        targetColor[0] = lerp(targetColor[0], v, params.color.grayscaleMix);
-                        targetColor[1] = lerp(targetColor[1], v, params.color.grayscaleMix);
-                        targetColor[2] = lerp(targetColor[2], v, params.color.grayscaleMix);
-                        targetColor[3] = 1.0f;
-                    }
-                    else
-                    {
-                        targetColor[0] = rgbaToGrayscale(targetColor, params.color.grayscaleType);
-                        targetColor[1] = targetColor[0];
-                        targetColor[2] = targetColor[0];
-                        targetColor[3] = 1.0f;
-                    }
+            // Pixels near or outside the edges
+            auto processEdge = [&](int xStart, int xEnd)
+            {
+                for (int x = xStart; x < xEnd; x++)
+                {
+                    float u = uRow + (uX * x);
+                    float v = vRow + (vX * x);
+                    float fu = floorf(u);
+                    float fv = floorf(v);
+                    int ix = (int)fu;
+                    int iy = (int)fv;
+                    __m128 tx = _mm_set1_ps(u - fu);
+                    __m128 ty = _mm_set1_ps(v - fv);
+
+                    __m128 top = lerpPixels(getPixel(ix, iy), getPixel(ix + 1, iy), tx);
+                    __m128 bottom = lerpPixels(getPixel(ix, iy + 1), getPixel(ix + 1, iy + 1), tx);
+                    colorOps.apply(lerpPixels(top, bottom, ty), outRow + (x * 4));
                 }
+            };
 
-                // Put tagetColor in the output buffer
-                redIndexOutput = (y * resizedWidth + x) * 4;
-                std::copy(targetColor, targetColor + 4, &(outputBuffer[redIndexOutput]));
+            processEdge(0, spanStart);
+
+            // Interior, no bounds checks. The indices are clamped in case the
+            // compiler evaluates u and v differently from isInside().
+            for (int x = spanStart; x < spanEnd; x++)
+            {
+                float u = uRow + (uX * x);
+                float v = vRow + (vX * x);
+                int ix = std::min((int)u, cropW - 2);
+                int iy = std::min((int)v, cropH - 2);
+                __m128 tx = _mm_set1_ps(u - (float)ix);
+                __m128 ty = _mm_set1_ps(v - (float)iy);
+
+                const float* p = cropData + (iy * inputStride) + (ix * 4);
+                __m128 top = lerpPixels(_mm_loadu_ps(p), _mm_loadu_ps(p + 4), tx);
+                __m128 bottom = lerpPixels(_mm_loadu_ps(p + inputStride), _mm_loadu_ps(p + inputStride + 4), tx);
+                colorOps.apply(lerpPixels(top, bottom, ty), outRow + (x * 4));
             }
+
+            processEdge(spanEnd, (int)resizedWidth);
         }
     }
 
@@ -565,7 +698,7 @@ void ImageTransform::applyNoCropCPU(
 
 void ImageTransform::applyNoCropGPU(
     const ImageTransformParams& params,
-    const std::vector<float>* lastBuffer,
+    const float* lastBuffer,
     uint32_t lastBufferWidth,
     uint32_t lastBufferHeight,
     std::vector<float>& outputBuffer,
@@ -589,7 +722,7 @@ void ImageTransform::applyNoCropGPU(
             texture.setBorderColor({ 0.0f, 0.0f, 0.0f, 1.0f });
 
         // Upload the input buffer
-        texture.upload(lastBuffer->data());
+        texture.upload(lastBuffer);
 
         // Create a framebuffer
         GlFramebuffer framebuffer(resizedWidth, resizedHeight);
@@ -793,9 +926,25 @@ void ImageTransform::getOutputDimensions(
         resizeY);
 }
 
+void ImageTransform::getCropStart(
+    const ImageTransformParams& params,
+    uint32_t inputWidth,
+    uint32_t inputHeight,
+    uint32_t croppedWidth,
+    uint32_t croppedHeight,
+    uint32_t& outCropStartX,
+    uint32_t& outCropStartY)
+{
+    float cropMaxOffsetX = fmaxf((float)inputWidth - (float)croppedWidth, 0.0f);
+    float cropMaxOffsetY = fmaxf((float)inputHeight - (float)croppedHeight, 0.0f);
+
+    outCropStartX = (uint32_t)floorf(std::clamp(params.cropResize.origin[0], 0.0f, 1.0f) * cropMaxOffsetX);
+    outCropStartY = (uint32_t)floorf(std::clamp(params.cropResize.origin[1], 0.0f, 1.0f) * cropMaxOffsetY);
+}
+
 void ImageTransform::apply(
     const ImageTransformParams& params,
-    const std::vector<float>& inputBuffer,
+    const FloatBuffer& inputBuffer,
     uint32_t inputWidth,
     uint32_t inputHeight,
     std::vector<float>& outputBuffer,
@@ -831,43 +980,42 @@ void ImageTransform::apply(
     outputWidth = resizedWidth;
     outputHeight = resizedHeight;
 
-    // Define the input buffer for later transforms
-    const std::vector<float>* lastBuffer = &inputBuffer;
+    // Crop offset
+    uint32_t cropStartX, cropStartY;
+    getCropStart(params, inputWidth, inputHeight, croppedWidth, croppedHeight, cropStartX, cropStartY);
 
-    // Crop
-    std::vector<float> croppedBuffer;
-    if ((cropX != 1.0f) || (cropY != 1.0f))
+    // Call the appropraite function
+    if (S_USE_GPU)
     {
-        lastBuffer = &croppedBuffer;
-
-        uint32_t croppedBufferSize = croppedWidth * croppedHeight * 4;
-        croppedBuffer.resize(croppedBufferSize);
+        // Define the input buffer for later transforms
+        const float* lastBuffer = inputBuffer.data();
 
-        float cropMaxOffsetX = inputWidth - croppedWidth;
-        float cropMaxOffsetY = inputHeight - croppedHeight;
+        // Crop
+        PooledVector<float> croppedBuffer;
+        if ((cropX != 1.0f) || (cropY != 1.0f))
+        {
 
-        uint32_t cropStartX = (uint32_t)floorf(params.cropResize.origin[0] * cropMaxOffsetX);
-        uint32_t cropStartY = (uint32_t)floorf(params.cropResize.origin[1] * cropMaxOffsetY);
+            uint32_t croppedBufferSize = croppedWidth * croppedHeight * 4;
+            croppedBuffer.resize(croppedBufferSize);
 
 #pragma omp parallel for
-        for (int y = 0; y < croppedHeight; y++)
-        {
-            for (int x = 0; x < croppedWidth; x++)
+            for (int y = 0; y < croppedHeight; y++)
             {
-                uint32_t redIndexCropped = 4 * (y * croppedWidth + x);
-                uint32_t redIndexInput = 4 * (((y + cropStartY) * inputWidth) + x + cropStartX);
+                for (int x = 0; x < croppedWidth; x++)
+                {
+                    uint32_t redIndexCropped = 4 * (y * croppedWidth + x);
+                    uint32_t redIndexInput = 4 * (((y + cropStartY) * inputWidth) + x + cropStartX);
 
-                croppedBuffer[redIndexCropped + 0] = inputBuffer[redIndexInput + 0];
-                croppedBuffer[redIndexCropped + 1] = inputBuffer[redIndexInput + 1];
-                croppedBuffer[redIndexCropped + 2] = inputBuffer[redIndexInput + 2];
-                croppedBuffer[redIndexCropped + 3] = inputBuffer[redIndexInput + 3];
+                    croppedBuffer[redIndexCropped + 0] = inputBuffer[redIndexInput + 0];
+                    croppedBuffer[redIndexCropped + 1] = inputBuffer[redIndexInput + 1];
+                    croppedBuffer[redIndexCropped + 2] = inputBuffer[redIndexInput + 2];
+                    croppedBuffer[redIndexCropped + 3] = inputBuffer[redIndexInput + 3];
+                }
             }
+
+            lastBuffer = croppedBuffer.data();
         }
-    }
 
-    // Call the appropraite function
-    if (S_USE_GPU)
-    {
         applyNoCropGPU(
             params,
             lastBuffer,
@@ -882,9 +1030,14 @@ void ImageTransform::apply(
     }
     else
     {
-        applyNoCropCPU(
+        // The crop is done while sampling
+        applyCPU(
             params,
-            lastBuffer,
+            inputBuffer,
+            inputWidth,
+            inputHeight,
+            cropStartX,
+            cropStartY,
             croppedWidth,
             croppedHeight,
             outputBuffer,
@@ -895,3 +1048,41 @@ void ImageTransform::apply(
             previewMode);
     }
 }
+
+bool ImageTransform::isIdentity(
+    const ImageTransformParams& params,
+    const FloatBuffer& inputBuffer,
+    bool previewMode)
+{
+    const ImageTransformParams::CropResizeParams& cropResize = params.cropResize;
+    const ImageTransformParams::TransformParams& transform = params.transform;
+    const ImageTransformParams::ColorParams& color = params.color;
+
+    if (previewMode && (cropResize.previewOrigin || transform.previewOrigin))
+        return false;
+
+    if ((cropResize.crop[0] != 1.0f) || (cropResize.crop[1] != 1.0f)
+        || (cropResize.resize[0] != 1.0f) || (cropResize.resize[1] != 1.0f))
+        return false;
+
+    if ((transform.scale[0] != 1.0f) || (transform.scale[1] != 1.0f)
+        || (transform.rotate != 0.0f)
+        || (transform.translate[0] != 0.0f) || (transform.translate[1] != 0.0f))
+        return false;
+
+    if ((color.filter[0] != 1.0f) || (color.filter[1] != 1.0f) || (color.filter[2] != 1.0f)
+        || (color.exposure != 0.0f)
+        || (color.contrast != 0.0f)
+        || (color.grayscaleType != GrayscaleType::None))
+        return false;
+
+    if (params.transparency)
+        return true;
+
+    // The alpha channel is reset to 1 without transparency
+    for (size_t i = 3; i < inputBuffer.size(); i += 4)
+        if (inputBuffer[i] != 1.0f)
+            return false;
+
+    return true;
+}
@@ -15,6 +15,9 @@
 #include "OpenGL/GlUtils.h"
 
 #include "Bilinear.h"
+#include "Hash.h"
+#include "BufferPool.h"
+#include "FloatBuffer.h"
 #include "NumberHelpers.h"
 #include "Misc.h"
 
@@ -28,6 +31,7 @@ struct ImageTransformParams
         bool previewOrigin = false;
 
         void reset();
+        void hash(Hasher& hasher) const;
     };
 
     struct TransformParams
@@ -39,6 +43,7 @@ struct ImageTransformParams
         bool previewOrigin = false;
 
         void reset();
+        void hash(Hasher& hasher) const;
     };
 
     struct ColorParams
@@ -51,6 +56,7 @@ struct ImageTransformParams
         float grayscaleMix = 1.0f;
 
         void reset();
+        void hash(Hasher& hasher) const;
     };
 
     CropResizeParams cropResize;
@@ -59,6 +65,7 @@ struct ImageTransformParams
     bool transparency = false;
 
     void reset();
+    void hash(Hasher& hasher) const;
 };
 
 // Image Transform Tool
@@ -95,9 +102,20 @@ public:
         uint32_t& outputHeight
     );
 
+    // Top-left corner of the area kept by the crop
+    static void getCropStart(
+        const ImageTransformParams& params,
+        uint32_t inputWidth,
+        uint32_t inputHeight,
+        uint32_t croppedWidth,
+        uint32_t croppedHeight,
+        uint32_t& outCropStartX,
+        uint32_t& outCropStartY
+    );
+
     static void apply(
         const ImageTransformParams& params,
-        const std::vector<float>& inputBuffer,
+        const FloatBuffer& inputBuffer,
         uint32_t inputWidth,
         uint32_t inputHeight,
         std::vector<float>& outputBuffer,
@@ -105,6 +123,13 @@ public:
         uint32_t& outputHeight,
         bool previewMode);
 
+    // Whether apply() would output the input as is, in which case the
+    // input buffer can be used without transforming or copying it
+    static bool isIdentity(
+        const ImageTransformParams& params,
+        const FloatBuffer& inputBuffer,
+        bool previewMode);
+
 private:
     static GLuint s_vertShader;
     static GLuint s_fragShader;
@@ -113,11 +138,16 @@ private:
     static bool s_gpuInitialized;
     static void ensureInitGPU();
 
-    static void applyNoCropCPU(
+    // Crop, resize, transform, and color operations in a single pass
+    static void applyCPU(
         const ImageTransformParams& params,
-        const std::vector<float>* lastBuffer,
-        uint32_t lastBufferWidth,
-        uint32_t lastBufferHeight,
+        const FloatBuffer& inputBuffer,
+        uint32_t inputWidth,
+        uint32_t inputHeight,
+        uint32_t cropStartX,
+        uint32_t cropStartY,
+        uint32_t croppedWidth,
+        uint32_t croppedHeight,
         std::vector<float>& outputBuffer,
         uint32_t resizedWidth,
         uint32_t resizedHeight,
@@ -127,7 +157,7 @@ private:
 
     static void applyNoCropGPU(
         const ImageTransformParams& params,
-        const std::vector<float>* lastBuffer,
+        const float* lastBuffer,
         uint32_t lastBufferWidth,
         uint32_t lastBufferHeight,
         std::vector<float>& outputBuffer,
@@ -0,0 +1,60 @@
+#include "LazyInit.h"
+
+std::vector<StartupPhase> StartupTimes::S_PHASES;
+std::mutex StartupTimes::S_MUTEX;
+
+// Time spent in the initializers that ran inside the current one, so that
+// nested phases aren't counted twice
+static thread_local float t_nestedMs = 0.0f;
+
+void StartupTimes::add(const std::string& name, float elapsedMs)
+{
+    std::scoped_lock lock(S_MUTEX);
+    S_PHASES.push_back({ name, elapsedMs });
+}
+
+std::vector<StartupPhase> StartupTimes::get()
+{
+    std::scoped_lock lock(S_MUTEX);
+    return S_PHASES;
+}
+
+LazyInit::LazyInit(const std::string& name)
+    : m_name(name)
+{}
+
+void LazyInit::ensure(const std::function<void()>& initializer)
+{
+    if (m_done)
+        return;
+
+    std::scoped_lock lock(m_mutex);
+    if (m_started)
+        return;
+    m_started = true;
+
+    float outerNestedMs = t_nestedMs;
+    t_nestedMs = 0.0f;
+
+    std::chrono::system_clock::time_point startTime = std::chrono::system_clock::now();
+    try
+    {
+        initializer();
+    }
+    catch (...)
+    {
+        t_nestedMs = outerNestedMs;
+        throw;
+    }
+    float elapsedMs = getElapsedMs(startTime);
+
+    StartupTimes::add(m_name, std::max(elapsedMs - t_nestedMs, 0.0f));
+    t_nestedMs = outerNestedMs + elapsedMs;
+
+    m_done = true;
+}
+
+bool LazyInit::done() const
+{
+    return m_done;
+}
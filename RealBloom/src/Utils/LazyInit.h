@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+#include "Misc.h"
+
+struct StartupPhase
+{
+    std::string name;
+    float elapsedMs = 0.0f;
+};
+
+// How long each phase of the startup took, including subsystems that were
+// initialized later on, in the order they finished. Phases initialized
+// within another one are excluded from its time, so they add up to the
+// total (Global)
+class StartupTimes
+{
+public:
+    StartupTimes() = delete;
+    StartupTimes(const StartupTimes&) = delete;
+    StartupTimes& operator= (const StartupTimes&) = delete;
+
+    static void add(const std::string& name, float elapsedMs);
+    static std::vector<StartupPhase> get();
+
+private:
+    static std::vector<StartupPhase> S_PHASES;
+    static std::mutex S_MUTEX;
+
+};
+
+// Runs an initializer on the first call to ensure() and adds its duration
+// to the startup times, minus the time spent in other LazyInits it
+// triggered. Other threads wait until it's done, and calls made
+// from within the initializer return right away.
+class LazyInit
+{
+public:
+    LazyInit(const std::string& name);
+
+    LazyInit(const LazyInit&) = delete;
+    LazyInit& operator= (const LazyInit&) = delete;
+
+    void ensure(const std::function<void()>& initializer);
+    bool done() const;
+
+private:
+    std::string m_name;
+    std::atomic_bool m_done = false;
+    bool m_started = false;
+    std::recursive_mutex m_mutex;
+
+};
@@ -0,0 +1,74 @@
+#include "MappedFile.h"
+
+MappedFile::MappedFile(const std::string& filename)
+{
+    std::wstring path = std::filesystem::path(filename).wstring();
+
+    m_file = CreateFileW(
+        path.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_DELETE,
+        NULL,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL);
+    if (m_file == INVALID_HANDLE_VALUE)
+        throw std::exception(makeError(__FUNCTION__, "", strFormat("Couldn't open \"%s\"", filename.c_str())).c_str());
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(m_file, &size) || (size.QuadPart < 1))
+    {
+        close();
+        throw std::exception(makeError(__FUNCTION__, "", strFormat("\"%s\" is empty", filename.c_str())).c_str());
+    }
+    m_size = (size_t)size.QuadPart;
+
+    m_mapping = CreateFileMappingW(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (m_mapping == NULL)
+    {
+        close();
+        throw std::exception(makeError(__FUNCTION__, "", strFormat("Couldn't map \"%s\"", filename.c_str())).c_str());
+    }
+
+    m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!m_data)
+    {
+        close();
+        throw std::exception(makeError(__FUNCTION__, "", strFormat("Couldn't map \"%s\"", filename.c_str())).c_str());
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+const uint8_t* MappedFile::getData() const
+{
+    return m_data;
+}
+
+size_t MappedFile::getSize() const
+{
+    return m_size;
+}
+
+void MappedFile::close()
+{
+    if (m_data)
+    {
+        UnmapViewOfFile(m_data);
+        m_data = nullptr;
+    }
+    if (m_mapping != NULL)
+    {
+        CloseHandle(m_mapping);
+        m_mapping = NULL;
+    }
+    if (m_file != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_file);
+        m_file = INVALID_HANDLE_VALUE;
+    }
+    m_size = 0;
+}
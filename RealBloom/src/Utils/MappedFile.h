@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <filesystem>
+#include <cstdint>
+
+#include "Misc.h"
+
+// Read-only view of a whole file mapped into memory. Pages are loaded by
+// the OS as they're accessed, and can be shared with other processes that
+// map the same file. The file can be renamed while it's mapped, but it
+// can't be replaced or deleted until every view of it is closed.
+class MappedFile
+{
+public:
+    MappedFile(const std::string& filename);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator= (const MappedFile&) = delete;
+
+    // Starts on a page boundary
+    const uint8_t* getData() const;
+    size_t getSize() const;
+
+private:
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = NULL;
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+
+    void close();
+
+};
@@ -175,6 +175,72 @@ bool deleteFile(const std::string& filename)
     return true;
 }
 
+bool matchWildcard(const std::string& pattern, const std::string& s)
+{
+    // Greedy matching with backtracking to the last star
+    size_t p = 0, i = 0;
+    size_t starP = std::string::npos, starI = 0;
+
+    while (i < s.size())
+    {
+        if ((p < pattern.size()) && ((pattern[p] == '?') || (tolower(pattern[p]) == tolower(s[i]))))
+        {
+            p++;
+            i++;
+        }
+        else if ((p < pattern.size()) && (pattern[p] == '*'))
+        {
+            starP = p++;
+            starI = i;
+        }
+        else if (starP != std::string::npos)
+        {
+            p = starP + 1;
+            i = ++starI;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    while ((p < pattern.size()) && (pattern[p] == '*'))
+        p++;
+
+    return p == pattern.size();
+}
+
+std::vector<std::string> findFiles(const std::string& pattern)
+{
+    std::vector<std::string> files;
+
+    std::filesystem::path path(pattern);
+    std::string filenamePattern = path.filename().string();
+
+    if (filenamePattern.find_first_of("*?") == std::string::npos)
+    {
+        if (std::filesystem::is_regular_file(path))
+            files.push_back(pattern);
+        return files;
+    }
+
+    std::filesystem::path dir = path.parent_path();
+    if (dir.empty())
+        dir = ".";
+
+    if (!std::filesystem::is_directory(dir))
+        return files;
+
+    for (const auto& entry : std::filesystem::directory_iterator(dir))
+    {
+        if (entry.is_regular_file() && matchWildcard(filenamePattern, entry.path().filename().string()))
+            files.push_back(entry.path().string());
+    }
+
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
 void killProcess(PROCESS_INFORMATION pi)
 {
     if (TerminateProcess(pi.hProcess, 1))
@@ -50,11 +50,11 @@ void printInfo(
 
 void setPrintHandler(std::function<void(std::string)> handler);
 
-template <typename T>
-void clearVector(std::vector<T>& v)
+template <typename T, typename A>
+void clearVector(std::vector<T, A>& v)
 {
     v.clear();
-    std::vector<T>().swap(v);
+    std::vector<T, A>().swap(v);
 }
 
 template <typename T>
@@ -115,6 +115,10 @@ std::string getLocalPath(const std::string& path);
 std::string getFileExtension(const std::string& filename);
 bool deleteFile(const std::string& filename);
 
+// Wildcards (* and ?) are only supported in the filename, not the directory
+bool matchWildcard(const std::string& pattern, const std::string& s);
+std::vector<std::string> findFiles(const std::string& pattern);
+
 void killProcess(PROCESS_INFORMATION pi);
 bool processIsRunning(PROCESS_INFORMATION pi);
 void openURL(std::string url);
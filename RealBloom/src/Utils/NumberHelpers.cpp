@@ -1,5 +1,7 @@
 #include "NumberHelpers.h"
 
+#include <cstring>
+
 uint8_t doubleTo8bit(double v)
 {
     v = fmax(v, 0);
@@ -71,6 +73,34 @@ void rotatePointInPlace(float& x, float& y, float pivotX, float pivotY, float an
     y = resultY;
 }
 
+uint32_t upperSmoothNumber(uint32_t v)
+{
+    // Smallest number >= v with no prime factors other than 2, 3, and 5.
+    // FFTs are considerably faster on these sizes.
+
+    if (v <= 1)
+        return 1;
+
+    uint64_t best = 1;
+    while (best < v)
+        best *= 2;
+
+    for (uint64_t p5 = 1; p5 < best; p5 *= 5)
+    {
+        for (uint64_t p35 = p5; p35 < best; p35 *= 3)
+        {
+            uint64_t n = p35;
+            while (n < v)
+                n *= 2;
+
+            if (n < best)
+                best = n;
+        }
+    }
+
+    return (uint32_t)best;
+}
+
 void calcFftConvPadding(
     bool powerOfTwo,
     bool square,
@@ -122,6 +152,88 @@ void calcDispScale(uint32_t index, uint32_t steps, float amount, float edgeOffse
     outAreaMul = 1.0f / area;
 }
 
+uint16_t floatToHalf(float v)
+{
+    uint32_t x;
+    std::memcpy(&x, &v, sizeof(x));
+
+    uint32_t sign = (x >> 16) & 0x8000;
+    uint32_t absX = x & 0x7FFFFFFF;
+
+    // Inf or NaN
+    if (absX >= 0x7F800000)
+        return sign | 0x7C00 | ((absX > 0x7F800000) ? 0x200 : 0);
+
+    // Rounds up to Inf (65520 and above)
+    if (absX >= 0x477FF000)
+        return sign | 0x7C00;
+
+    // Subnormal or zero
+    if (absX < 0x38800000)
+    {
+        if (absX < 0x33000000)
+            return sign;
+
+        uint32_t exponent = absX >> 23;
+        uint32_t mantissa = (absX & 0x7FFFFF) | 0x800000;
+        uint32_t shift = 126 - exponent;
+
+        uint32_t h = mantissa >> shift;
+        uint32_t rem = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if ((rem > halfway) || ((rem == halfway) && (h & 1)))
+            h++;
+
+        return sign | h;
+    }
+
+    // Normal, rebias the exponent from 127 to 15
+    uint32_t h = (absX - 0x38000000) >> 13;
+    uint32_t rem = absX & 0x1FFF;
+    if ((rem > 0x1000) || ((rem == 0x1000) && (h & 1)))
+        h++;
+
+    return sign | h;
+}
+
+float halfToFloat(uint16_t v)
+{
+    uint32_t sign = (uint32_t)(v & 0x8000) << 16;
+    uint32_t exponent = (v >> 10) & 0x1F;
+    uint32_t mantissa = v & 0x3FF;
+
+    uint32_t x;
+    if (exponent == 0x1F)
+    {
+        // Inf or NaN
+        x = sign | 0x7F800000 | (mantissa << 13);
+    }
+    else if (exponent != 0)
+    {
+        x = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+    else if (mantissa == 0)
+    {
+        x = sign;
+    }
+    else
+    {
+        // Subnormal, normalize it
+        exponent = 113;
+        while (!(mantissa & 0x400))
+        {
+            mantissa <<= 1;
+            exponent--;
+        }
+        mantissa &= 0x3FF;
+        x = sign | (exponent << 23) | (mantissa << 13);
+    }
+
+    float f;
+    std::memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
 float srgbToLinear_DEPRECATED(float x)
 {
     if (x <= 0.0f)
@@ -107,7 +107,7 @@ constexpr uint32_t GrayscaleType_EnumSize = 12;
 
 constexpr GrayscaleType CONV_THRESHOLD_GRAYSCALE_TYPE = GrayscaleType::Average;
 
-inline float rgbaToGrayscale(float* rgba, GrayscaleType type)
+inline float rgbaToGrayscale(const float* rgba, GrayscaleType type)
 {
     switch (type)
     {
@@ -151,7 +151,7 @@ inline float rgbaToGrayscale(float* rgba, GrayscaleType type)
     return rgba[0];
 }
 
-inline float rgbToGrayscale(float* rgb, GrayscaleType type)
+inline float rgbToGrayscale(const float* rgb, GrayscaleType type)
 {
     switch (type)
     {
@@ -223,6 +223,8 @@ float applyContrast(float v, float contrast);
 void rotatePoint(float x, float y, float pivotX, float pivotY, float angle, float& outX, float& outY);
 void rotatePointInPlace(float& x, float& y, float pivotX, float pivotY, float angle);
 
+uint32_t upperSmoothNumber(uint32_t v);
+
 void calcFftConvPadding(
     bool powerOfTwo,
     bool square,
@@ -237,5 +239,9 @@ void calcFftConvPadding(
 
 void calcDispScale(uint32_t index, uint32_t steps, float amount, float edgeOffset, float& outScale, float& outAreaMul);
 
+// IEEE 754 half-precision conversion, rounds to the nearest even
+uint16_t floatToHalf(float v);
+float halfToFloat(uint16_t v);
+
 float srgbToLinear_DEPRECATED(float x);
 float linearToSrgb_DEPRECATED(float x);
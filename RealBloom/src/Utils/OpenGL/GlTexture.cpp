@@ -52,6 +52,20 @@ void GlTexture::upload(const float* data)
     checkGlStatus(__FUNCTION__, "glTexImage2D");
 }
 
+void GlTexture::uploadRegion(const float* data, uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t rowLength)
+{
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    checkGlStatus(__FUNCTION__, "glBindTexture");
+
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, rowLength);
+    checkGlStatus(__FUNCTION__, "glPixelStorei");
+
+    // Restore the row length before checking so it's not left behind on errors
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_RGBA, GL_FLOAT, data);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    checkGlStatus(__FUNCTION__, "glTexSubImage2D");
+}
+
 void GlTexture::bind(GLenum texUnit)
 {
     glActiveTexture(texUnit);
@@ -29,6 +29,10 @@ public:
 
     // RGBA32F
     void upload(const float* data);
+
+    // Replaces a region of the texture after it's been uploaded once.
+    // rowLength: Number of pixels between the start of two rows in data
+    void uploadRegion(const float* data, uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t rowLength);
     void bind(GLenum texUnit);
     void bind();
     void setBorderColor(std::array<float, 4> color);
@@ -0,0 +1,266 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <cstdint>
+
+#include <xmmintrin.h>
+
+#include "BufferPool.h"
+#include "Misc.h"
+
+// Image with one plane per channel. Rows are padded to a multiple of 64
+// bytes and start on a 64-byte boundary, so every row can be processed with
+// aligned SIMD loads, and kernels don't have to skip over channels they
+// don't use. The storage comes from the buffer pool.
+template <typename T>
+class PlanarImage
+{
+public:
+    static constexpr size_t ALIGNMENT = BUFFER_POOL_ALIGNMENT;
+
+    PlanarImage() {};
+
+    // The content is zeroed
+    void resize(uint32_t width, uint32_t height, uint32_t numPlanes);
+    void reset();
+    void fill(const T& value);
+
+    uint32_t getWidth() const;
+    uint32_t getHeight() const;
+    uint32_t getNumPlanes() const;
+
+    // Number of elements between the start of two rows
+    size_t getStride() const;
+    static size_t calcStride(uint32_t width);
+
+    T* getPlane(uint32_t plane);
+    const T* getPlane(uint32_t plane) const;
+    T* getRow(uint32_t plane, uint32_t y);
+    const T* getRow(uint32_t plane, uint32_t y) const;
+
+    T& operator()(uint32_t plane, uint32_t y, uint32_t x);
+    const T& operator()(uint32_t plane, uint32_t y, uint32_t x) const;
+
+    // Adds the planes of another image with the same dimensions
+    void add(const PlanarImage<T>& other, T multiplier = 1);
+
+    // Conversion from and to interleaved RGBA buffers, every 4 elements
+    // represent a pixel.
+    // deinterleave: Copies the channels starting from firstChannel into the
+    // planes, with the top-left corner of the buffer at (offsetX, offsetY).
+    // The rest of the image is left untouched.
+    // interleave: Writes RGB and sets alpha to 1. An image with one plane is
+    // written as grayscale.
+    void deinterleave(
+        const float* buffer, uint32_t bufferWidth, uint32_t bufferHeight,
+        uint32_t firstChannel = 0, uint32_t offsetX = 0, uint32_t offsetY = 0);
+    void interleave(float* buffer) const;
+
+private:
+    PooledVector<T> m_data;
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    uint32_t m_numPlanes = 0;
+    size_t m_stride = 0;
+
+};
+
+template <typename T>
+void PlanarImage<T>::resize(uint32_t width, uint32_t height, uint32_t numPlanes)
+{
+    m_width = width;
+    m_height = height;
+    m_numPlanes = numPlanes;
+    m_stride = calcStride(width);
+
+    m_data.assign(m_stride * (size_t)height * (size_t)numPlanes, (T)0);
+}
+
+template <typename T>
+void PlanarImage<T>::reset()
+{
+    clearVector(m_data);
+    m_width = 0;
+    m_height = 0;
+    m_numPlanes = 0;
+    m_stride = 0;
+}
+
+template <typename T>
+void PlanarImage<T>::fill(const T& value)
+{
+    std::fill(m_data.begin(), m_data.end(), value);
+}
+
+template <typename T>
+uint32_t PlanarImage<T>::getWidth() const
+{
+    return m_width;
+}
+
+template <typename T>
+uint32_t PlanarImage<T>::getHeight() const
+{
+    return m_height;
+}
+
+template <typename T>
+uint32_t PlanarImage<T>::getNumPlanes() const
+{
+    return m_numPlanes;
+}
+
+template <typename T>
+size_t PlanarImage<T>::getStride() const
+{
+    return m_stride;
+}
+
+template <typename T>
+size_t PlanarImage<T>::calcStride(uint32_t width)
+{
+    constexpr size_t rowAlign = ALIGNMENT / sizeof(T);
+    return (((size_t)width + rowAlign - 1) / rowAlign) * rowAlign;
+}
+
+template <typename T>
+T* PlanarImage<T>::getPlane(uint32_t plane)
+{
+    return m_data.data() + (m_stride * (size_t)m_height * (size_t)plane);
+}
+
+template <typename T>
+const T* PlanarImage<T>::getPlane(uint32_t plane) const
+{
+    return m_data.data() + (m_stride * (size_t)m_height * (size_t)plane);
+}
+
+template <typename T>
+T* PlanarImage<T>::getRow(uint32_t plane, uint32_t y)
+{
+    return getPlane(plane) + (m_stride * (size_t)y);
+}
+
+template <typename T>
+const T* PlanarImage<T>::getRow(uint32_t plane, uint32_t y) const
+{
+    return getPlane(plane) + (m_stride * (size_t)y);
+}
+
+template <typename T>
+T& PlanarImage<T>::operator()(uint32_t plane, uint32_t y, uint32_t x)
+{
+    return getRow(plane, y)[x];
+}
+
+template <typename T>
+const T& PlanarImage<T>::operator()(uint32_t plane, uint32_t y, uint32_t x) const
+{
+    return getRow(plane, y)[x];
+}
+
+template <typename T>
+void PlanarImage<T>::add(const PlanarImage<T>& other, T multiplier)
+{
+    // Padding included, the planes are contiguous
+    const size_t size = std::min(m_data.size(), other.m_data.size());
+    T* target = m_data.data();
+    const T* source = other.m_data.data();
+    for (size_t i = 0; i < size; i++)
+        target[i] += source[i] * multiplier;
+}
+
+template <typename T>
+void PlanarImage<T>::deinterleave(
+    const float* buffer, uint32_t bufferWidth, uint32_t bufferHeight,
+    uint32_t firstChannel, uint32_t offsetX, uint32_t offsetY)
+{
+    const uint32_t numPlanes = std::min(m_numPlanes, 4 - std::min(firstChannel, 4u));
+    const uint32_t width = std::min(bufferWidth, (offsetX < m_width) ? (m_width - offsetX) : 0);
+    const uint32_t height = std::min(bufferHeight, (offsetY < m_height) ? (m_height - offsetY) : 0);
+
+    for (uint32_t y = 0; y < height; y++)
+    {
+        const float* source = buffer + ((size_t)y * bufferWidth * 4);
+        uint32_t x = 0;
+
+        // 4 pixels at a time, transposed into one vector per channel
+        if constexpr (std::is_same_v<T, float>)
+        {
+            if ((firstChannel == 0) && (numPlanes >= 3))
+            {
+                float* r = getRow(0, y + offsetY) + offsetX;
+                float* g = getRow(1, y + offsetY) + offsetX;
+                float* b = getRow(2, y + offsetY) + offsetX;
+                float* a = (numPlanes > 3) ? (getRow(3, y + offsetY) + offsetX) : nullptr;
+
+                for (; (x + 4) <= width; x += 4)
+                {
+                    __m128 p0 = _mm_loadu_ps(source + (x * 4) + 0);
+                    __m128 p1 = _mm_loadu_ps(source + (x * 4) + 4);
+                    __m128 p2 = _mm_loadu_ps(source + (x * 4) + 8);
+                    __m128 p3 = _mm_loadu_ps(source + (x * 4) + 12);
+                    _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+
+                    _mm_storeu_ps(r + x, p0);
+                    _mm_storeu_ps(g + x, p1);
+                    _mm_storeu_ps(b + x, p2);
+                    if (a)
+                        _mm_storeu_ps(a + x, p3);
+                }
+            }
+        }
+
+        for (uint32_t i = 0; i < numPlanes; i++)
+        {
+            T* target = getRow(i, y + offsetY) + offsetX;
+            for (uint32_t xx = x; xx < width; xx++)
+                target[xx] = (T)source[(xx * 4) + firstChannel + i];
+        }
+    }
+}
+
+template <typename T>
+void PlanarImage<T>::interleave(float* buffer) const
+{
+    if (m_numPlanes < 1)
+        return;
+
+    const bool grayscale = m_numPlanes < 3;
+    for (uint32_t y = 0; y < m_height; y++)
+    {
+        float* target = buffer + ((size_t)y * m_width * 4);
+        const T* r = getRow(0, y);
+        const T* g = grayscale ? r : getRow(1, y);
+        const T* b = grayscale ? r : getRow(2, y);
+        uint32_t x = 0;
+
+        if constexpr (std::is_same_v<T, float>)
+        {
+            const __m128 one = _mm_set1_ps(1.0f);
+            for (; (x + 4) <= m_width; x += 4)
+            {
+                __m128 p0 = _mm_load_ps(r + x);
+                __m128 p1 = _mm_load_ps(g + x);
+                __m128 p2 = _mm_load_ps(b + x);
+                __m128 p3 = one;
+                _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+
+                _mm_storeu_ps(target + (x * 4) + 0, p0);
+                _mm_storeu_ps(target + (x * 4) + 4, p1);
+                _mm_storeu_ps(target + (x * 4) + 8, p2);
+                _mm_storeu_ps(target + (x * 4) + 12, p3);
+            }
+        }
+
+        for (; x < m_width; x++)
+        {
+            target[(x * 4) + 0] = (float)r[x];
+            target[(x * 4) + 1] = (float)g[x];
+            target[(x * 4) + 2] = (float)b[x];
+            target[(x * 4) + 3] = 1.0f;
+        }
+    }
+}